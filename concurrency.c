@@ -1,19 +1,461 @@
 
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // this custom header provides portable functions for Windows and POSIX threads
 #include "thread_helper.h"
 
-// define the number of concurrent threads to syncronize. Some implementations
-// below will not support more than two therads, and will fall back to two if a
-// larger number is used.
+// the fenced variants of the software guards below use C11 atomics, if the
+// compiler supports them
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define HAVE_C11_ATOMICS
+#endif
+
+// define the default number of concurrent threads to syncronize. Some
+// implementations below will not support more than two therads, and will fall
+// back to two if a larger number is used. The number of threads can be changed
+// at runtime with the --threads option, up to MAX_THREADS.
 #define THREADS 2
+#define MAX_THREADS 256
 
-// define the limit of the sum of consecutive integers to calculate
+// define the default limit of the sum of consecutive integers to calculate.
+// The limit can be changed at runtime with the --iterations option.
 #define SUM_TO 1000000LLU
 
-// this is a static shared variable, accessed by multiple threads concurrently
-volatile unsigned long long res = 0;
+// define the default bounds of the exponential backoff used by some guard
+// types, in number of relax hints. The bounds can be changed at runtime with
+// the --backoff-min and --backoff-max options.
+#define BACKOFF_MIN 4
+#define BACKOFF_MAX 1024
+
+// define the default number of times in a row the cohort lock is passed on
+// between threads of the same NUMA node, before it is handed to another node.
+// The bound can be changed at runtime with the --cohort-bound option.
+#define COHORT_BOUND 64
+
+// define the default percentage of operations of the reader-writer guards that
+// modify the shared variable. The ratio can be changed at runtime with the
+// --write-ratio option, where 100 makes them behave like exclusive locks.
+#define WRITE_RATIO 10
+
+// these are the parameters of the currently running experiment. They are set
+// by the main function before the threads are created, and only read by the
+// threads afterwards.
+static size_t nthreads = THREADS;
+static unsigned long long sum_to = SUM_TO;
+static unsigned long backoff_min = BACKOFF_MIN;
+static unsigned long backoff_max = BACKOFF_MAX;
+static unsigned long cohort_bound = COHORT_BOUND;
+static unsigned long write_ratio = WRITE_RATIO;
+
+// the wall-clock time of the current experiment, set by the main function
+// before the statistics of a guard type are printed, so that they can be
+// reported as rates.
+static unsigned long long experiment_ns;
+
+// if set with the --counters option, the performance counters of every thread
+// are collected during each experiment.
+static int counters = 0;
+
+// the shared variable below, and the shared state of most guard types, is
+// placed in this shared area, either packed densely, as the compiler would
+// place them, or padded, so that each of them, and each per-thread slot of an
+// array, occupies its own cache line. A write to a padded variable does not
+// invalidate the cached copies of any other variable on other CPUs, which is
+// known as false sharing. The layout can be chosen at runtime with the
+// --layout option.
+//
+// Only one guard type runs at a time, so the shared state of all guard types
+// is placed right after the shared variable, overlapping each other.
+//
+// The largest shared state is the one of the tournament tree, with two flags
+// and a turn for each of up to MAX_THREADS nodes.
+#define SHARED_AREA_LINES (3 * MAX_THREADS + 8)
+
+static THREAD_HELPER_CACHE_ALIGNED char shared_area[SHARED_AREA_LINES * THREAD_HELPER_CACHE_LINE];
+static size_t shared_used;
+
+// the distance between two slots of an array in the shared area, which is the
+// size of a cache line in the padded layout, and 0 in the packed layout, where
+// the slots are placed next to each other.
+static size_t slot_stride = 0;
+
+// this macro accesses the slot of the given thread in an array allocated in
+// the shared area.
+#define SLOT(array, id) ((array)[(id) * (slot_stride ? slot_stride / sizeof(*(array)) : 1)])
+
+// this function allocates an array of slots of the given size in the shared
+// area, and returns a pointer to the first slot.
+static void*
+shared_alloc (size_t size, size_t count)
+{
+  size_t stride = slot_stride ? slot_stride : size;
+  shared_used = (shared_used + stride - 1) / stride * stride;
+  void *ptr = shared_area + shared_used;
+  shared_used += stride * count;
+  return ptr;
+}
+
+// this is a shared variable, accessed by multiple threads concurrently
+volatile unsigned long long *res;
+
+// when compiled with HAVE_STATS, every thread function below measures the time
+// it waits to enter its critical section, and the time it holds it, for every
+// single acquisition. The times are recorded in per-thread histograms with
+// logarithmic buckets, where every power of two is split into 8 sub-buckets,
+// so that the relative error stays below 12.5% from nanoseconds to seconds.
+// The histograms are merged after the threads have been joined, and reported
+// as percentiles.
+//
+// Every thread of this exercise enters its critical section the same number
+// of times, so the fairness of a guard shows in how the acquisitions are
+// shared while all threads are still competing. Each thread therefore also
+// counts its acquisitions until the first thread is done, which are reported
+// together with the Jain fairness index: 1 if all threads got the same share,
+// and 1/n if a single thread of n got all of them.
+//
+// The measurements perturb the timing of the guards, so they are compiled
+// out by default.
+#ifdef HAVE_STATS
+#define STATS_SUB_BUCKETS 8
+#define STATS_BUCKETS (62 * STATS_SUB_BUCKETS)
+
+struct THREAD_HELPER_CACHE_ALIGNED stats_t
+{
+  unsigned long long wait[STATS_BUCKETS];
+  unsigned long long hold[STATS_BUCKETS];
+  unsigned long long max_wait;
+  unsigned long long max_hold;
+  unsigned long long acquisitions;
+  unsigned long long start_ns;
+  unsigned long long acquired_ns;
+};
+
+static struct stats_t stats[MAX_THREADS];
+static volatile int stats_first_done;
+
+// this function returns the histogram bucket of the given time.
+static size_t
+stats_bucket (unsigned long long ns)
+{
+  if (ns < STATS_SUB_BUCKETS)
+    return ns;
+  size_t msb = 3;
+  while (ns >> (msb + 1))
+    ++msb;
+  return (msb - 2) * STATS_SUB_BUCKETS + ((ns >> (msb - 3)) & (STATS_SUB_BUCKETS - 1));
+}
+
+// this function returns the largest time falling into the given bucket.
+static unsigned long long
+stats_bucket_limit (size_t bucket)
+{
+  if (bucket < STATS_SUB_BUCKETS)
+    return bucket;
+  size_t msb = bucket / STATS_SUB_BUCKETS + 2;
+  unsigned long long sub = bucket % STATS_SUB_BUCKETS;
+  return ((STATS_SUB_BUCKETS + sub + 1) << (msb - 3)) - 1;
+}
+
+static void
+stats_acquired (struct stats_t *s)
+{
+  s->acquired_ns = thread_helper_time_ns();
+  unsigned long long wait = s->acquired_ns - s->start_ns;
+  s->wait[stats_bucket(wait)]++;
+  if (wait > s->max_wait)
+    s->max_wait = wait;
+  if (!stats_first_done)
+    s->acquisitions++;
+}
+
+static void
+stats_release (struct stats_t *s)
+{
+  unsigned long long hold = thread_helper_time_ns() - s->acquired_ns;
+  s->hold[stats_bucket(hold)]++;
+  if (hold > s->max_hold)
+    s->max_hold = hold;
+}
+
+// this function prints the given percentiles of a merged histogram.
+static void
+stats_print_percentiles (const char *label, const unsigned long long *histogram, unsigned long long max)
+{
+  static const double percentiles[] = { 50.0, 99.0, 99.9 };
+  static const char *names[] = { "p50:", "p99:", "p99.9:" };
+
+  unsigned long long total = 0;
+  size_t b, p;
+  for (b = 0; b < STATS_BUCKETS; ++b)
+    total += histogram[b];
+
+  for (p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p)
+    {
+      unsigned long long rank = (unsigned long long)(total * percentiles[p] / 100.0 + 0.5), seen = 0;
+      for (b = 0; b < STATS_BUCKETS - 1 && seen + histogram[b] < rank; ++b)
+        seen += histogram[b];
+      printf("%s %-*s%17llu ns\n", label, (int)(14 - strlen(label)), names[p], stats_bucket_limit(b));
+    }
+  printf("%s %-*s%17llu ns\n", label, (int)(14 - strlen(label)), "max:", max);
+}
+
+// this function merges the histograms of all threads, and prints the wait and
+// hold time percentiles, the acquisitions of every thread, and the fairness.
+static void
+stats_report (void)
+{
+  static unsigned long long wait[STATS_BUCKETS], hold[STATS_BUCKETS];
+  unsigned long long max_wait = 0, max_hold = 0;
+  double sum = 0.0, sum_squares = 0.0;
+  size_t t, b;
+
+  memset(wait, 0, sizeof(wait));
+  memset(hold, 0, sizeof(hold));
+  for (t = 0; t < nthreads; ++t)
+    {
+      for (b = 0; b < STATS_BUCKETS; ++b)
+        {
+          wait[b] += stats[t].wait[b];
+          hold[b] += stats[t].hold[b];
+        }
+      if (stats[t].max_wait > max_wait)
+        max_wait = stats[t].max_wait;
+      if (stats[t].max_hold > max_hold)
+        max_hold = stats[t].max_hold;
+      sum += stats[t].acquisitions;
+      sum_squares += (double)stats[t].acquisitions * stats[t].acquisitions;
+    }
+
+  stats_print_percentiles("wait", wait, max_wait);
+  stats_print_percentiles("hold", hold, max_hold);
+  printf("acquisitions:  %20.0f (", sum);
+  for (t = 0; t < nthreads; ++t)
+    printf("%s%llu", t ? ", " : "", stats[t].acquisitions);
+  printf(")\n");
+  printf("fairness:      %20.3f\n", sum_squares > 0.0 ? sum * sum / (nthreads * sum_squares) : 1.0);
+}
+
+#define STATS_ACQUIRE() (stats[id].start_ns = thread_helper_time_ns())
+#define STATS_ACQUIRED() stats_acquired(&stats[id])
+#define STATS_RELEASE() stats_release(&stats[id])
+#else
+#define STATS_ACQUIRE() ((void)0)
+#define STATS_ACQUIRED() ((void)0)
+#define STATS_RELEASE() ((void)0)
+#endif
+
+// the workload executed by the thread functions below. By default, a thread
+// only adds a single number to the shared variable while holding the guard,
+// and immediately tries to enter the critical section again, which is the
+// worst case for every guard. To model more realistic programs, the critical
+// section can additionally update a number of cache lines of shared data,
+// with the --cs-lines option, and the threads can do some local computation
+// between two critical sections, with the --ncs-work option. With the
+// --work-distribution option, the amount of work is either fixed, or drawn
+// uniformly at random between 0 and twice the given amount for every single
+// critical section.
+#define WORK_MAX_LINES 4096
+
+enum work_distribution_t { WORK_FIXED, WORK_UNIFORM };
+
+static unsigned long work_cs_lines = 0;
+static unsigned long work_ncs = 0;
+static enum work_distribution_t work_distribution = WORK_FIXED;
+
+static THREAD_HELPER_CACHE_ALIGNED volatile unsigned long long work_data[WORK_MAX_LINES * THREAD_HELPER_CACHE_LINE / sizeof(unsigned long long)];
+
+// the state of the random number generator of each thread, and a sink for the
+// results of the local computation, so that the compiler cannot remove it
+struct THREAD_HELPER_CACHE_ALIGNED work_state_t
+{
+  unsigned long long seed;
+  unsigned long long sink;
+};
+
+static struct work_state_t work_states[MAX_THREADS];
+
+// this function returns the next number of the pseudo random number generator
+// of a thread.
+static unsigned long long
+work_random (struct work_state_t *state)
+{
+  // xorshift64 pseudo random number generator
+  //   see: https://www.jstatsoft.org/article/view/v008i14
+  state->seed ^= state->seed << 13;
+  state->seed ^= state->seed >> 7;
+  state->seed ^= state->seed << 17;
+  return state->seed;
+}
+
+// this function returns the amount of work for the next critical section,
+// according to the chosen distribution.
+static unsigned long
+work_amount (struct work_state_t *state, unsigned long amount)
+{
+  if (work_distribution == WORK_FIXED || amount == 0)
+    return amount;
+  return work_random(state) % (2 * amount + 1);
+}
+
+// this function updates a number of cache lines of the shared data, and must
+// be called while holding the guard.
+static void
+work_inside (int id)
+{
+  unsigned long n = work_amount(&work_states[id], work_cs_lines), l;
+  for (l = 0; l < n; ++l)
+    work_data[(l % WORK_MAX_LINES) * (THREAD_HELPER_CACHE_LINE / sizeof(unsigned long long))]++;
+}
+
+// this function computes locally for the given number of iterations, without
+// accessing any shared data.
+static void
+work_compute (struct work_state_t *state, unsigned long n)
+{
+  unsigned long long x = state->sink;
+  unsigned long k;
+  for (k = 0; k < n; ++k)
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  state->sink = x;
+}
+
+static void
+work_outside (int id)
+{
+  struct work_state_t *state = &work_states[id];
+  work_compute(state, work_amount(state, work_ncs));
+}
+
+#define WORK_INSIDE() do { if (work_cs_lines) work_inside(id); } while (0)
+#define WORK_OUTSIDE() do { if (work_ncs) work_outside(id); } while (0)
+
+// with the --try-timeout option, the guards semaphore, futex, test_and_set,
+// ttas, ticket, mcs and adaptive do not wait for the lock indefinitely, but
+// give up when it could not be acquired within the given time, or after a
+// single attempt for a timeout of 0. All other guards have no try-lock, and
+// are rejected with this option. After every failed attempt, the thread does --try-work
+// iterations of local work instead, as a service would shed a request or do
+// something else, and then tries again. The guards count their attempts, and
+// the work done while the lock could not be acquired.
+#define TRY_WORK 100
+
+static int try_mode = 0;
+static unsigned long long try_timeout = 0;
+static unsigned long try_work = TRY_WORK;
+
+struct THREAD_HELPER_CACHE_ALIGNED try_counts_t
+{
+  unsigned long long acquisitions;
+  unsigned long long failures;
+  unsigned long long wasted;
+};
+
+static struct try_counts_t try_counts[MAX_THREADS];
+
+static unsigned long long
+try_deadline (void)
+{
+  return thread_helper_time_ns() + try_timeout;
+}
+
+static void
+try_failed (int id)
+{
+  unsigned long n = work_amount(&work_states[id], try_work);
+  work_compute(&work_states[id], n);
+  try_counts[id].failures++;
+  try_counts[id].wasted += n;
+}
+
+// this function prints the number of attempts to acquire the guard, the share
+// of them that succeeded, and the local work done after the failed ones
+static void
+report_try (void)
+{
+  unsigned long long acquisitions = 0, failures = 0, wasted = 0;
+  size_t t;
+  for (t = 0; t < nthreads; ++t)
+    {
+      acquisitions += try_counts[t].acquisitions;
+      failures += try_counts[t].failures;
+      wasted += try_counts[t].wasted;
+    }
+  if (acquisitions == 0)
+    return;
+
+  printf("attempts:      %20llu\n", acquisitions + failures);
+  printf("success rate:  %19.1f%%\n", 100.0 * acquisitions / (acquisitions + failures));
+  printf("wasted work:   %17.1f /acquisition (%llu)\n", (double)wasted / acquisitions, wasted);
+}
+
+#define TRY_LOCK(trylock, timedlock) \
+  do { while ((try_timeout ? (timedlock) : (trylock)) != 0) try_failed(id); try_counts[id].acquisitions++; } while (0)
+
+// when built with HAVE_CHECK defined, every guard that claims mutual exclusion
+// counts the threads inside its critical section, and records the thread that
+// entered it last. A thread that finds another writer inside when entering,
+// or finds that another thread has entered in the meantime when leaving, has
+// detected a violation of the mutual exclusion. Readers of the reader-writer
+// guards count in the lower half of the counter, and may only overlap with
+// other readers. With the --jitter option, the threads additionally wait for
+// a random time inside and outside of the critical section, to expose races
+// that only show up with unlucky timing. Like the statistics above, the checks
+// perturb the timing of the guards, so they are compiled out by default.
+#ifdef HAVE_CHECK
+#define CHECK_WRITER (1ULL << 32)
+
+static THREAD_HELPER_CACHE_ALIGNED volatile unsigned long long check_occupancy;
+static volatile int check_owner;
+static volatile unsigned long long check_violations;
+static unsigned long check_jitter = 0;
+
+// this function spins for a random time of at most --jitter iterations.
+static void
+check_delay (int id)
+{
+  if (check_jitter)
+    {
+      unsigned long n = work_random(&work_states[id]) % (check_jitter + 1), k;
+      for (k = 0; k < n; ++k)
+        thread_helper_cpu_relax();
+    }
+}
+
+static void
+check_enter (int id, int write)
+{
+  unsigned long long occupancy = thread_helper_fetch_and_add(&check_occupancy, write ? CHECK_WRITER : 1);
+  if (write ? occupancy != 0 : occupancy >= CHECK_WRITER)
+    thread_helper_fetch_and_add(&check_violations, 1);
+  if (write)
+    check_owner = id;
+  check_delay(id);
+}
+
+static void
+check_leave (int id, int write)
+{
+  check_delay(id);
+  if (write && check_owner != id)
+    thread_helper_fetch_and_add(&check_violations, 1);
+  thread_helper_fetch_and_add(&check_occupancy, write ? -CHECK_WRITER : -1ULL);
+  check_delay(id);
+}
+
+#define CHECK_ENTER() check_enter(id, 1)
+#define CHECK_LEAVE() check_leave(id, 1)
+#define CHECK_READ_ENTER() check_enter(id, 0)
+#define CHECK_READ_LEAVE() check_leave(id, 0)
+#else
+#define CHECK_ENTER() ((void)0)
+#define CHECK_LEAVE() ((void)0)
+#define CHECK_READ_ENTER() ((void)0)
+#define CHECK_READ_LEAVE() ((void)0)
+#endif
 
 // this thread function will access the shared resource without any protection.
 // consequently, many write accesses will be lost and the result of the
@@ -23,23 +465,34 @@ sum_unguarded (void *args)
 {
   int id = *((int*)args);
 
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
       // no-op
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
       // no-op
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
+// shared state of the thread function below
+static volatile int *turns_turn;
+
 // this thread function will take turns between two accessing threads. this
 // will usually produce correct results, because mutual exclusion is
 // guaranteed, but will lead to unreasonably long run times for concurrent and
@@ -52,25 +505,34 @@ sum_turns (void *args)
 {
   int id = *((int*)args);
 
-  static volatile int turn = 0;
-
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      while (turn != id);
+      while (*turns_turn != id);
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      turn = id ^ 1;
+      *turns_turn = (id + 1) % nthreads;
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
+// shared state of the thread function below
+static volatile int *flags_raised;
+
 // this thread function will attempt to guarantee mutual exclusion by having
 // each thread attempting to enter the critical section raise a flag, and then
 // waiting until the flag of the other thread is lowered. This can easily lead
@@ -81,26 +543,36 @@ sum_flags (void *args)
 {
   int id = *((int*)args);
 
-  static volatile int flags[2] = { 0 };
-
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += 2)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      flags[id] = 1;
-      while (flags[id ^ 1] == 1);
+      SLOT(flags_raised, id) = 1;
+      while (SLOT(flags_raised, id ^ 1) == 1);
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      flags[id] = 0;
+      SLOT(flags_raised, id) = 0;
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
+// shared state of the thread function below
+static volatile int *peterson_flags;
+static volatile int *peterson_turn;
+
 // this thread function implements peterson's algorithm for two threads.
 // Peterson's Algorithm solves the critical section problem correctly in
 // theory, but will not work in practice due to hardware effects and the
@@ -110,28 +582,37 @@ sum_peterson (void *args)
 {
   int id = *((int*)args);
 
-  static volatile int flags[2] = { 0 };
-  static volatile int turn = 0;
-
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += 2)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      flags[id] = 1; turn = id ^ 1;
+      SLOT(peterson_flags, id) = 1; *peterson_turn = id ^ 1;
       // __sync_synchronize();
-      while ((flags[id ^ 1] == 1) && turn == (id ^ 1));
+      while ((SLOT(peterson_flags, id ^ 1) == 1) && *peterson_turn == (id ^ 1));
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      flags[id] = 0;
+      SLOT(peterson_flags, id) = 0;
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
+// shared state of the thread function below
+static volatile int *dekker_flags;
+static volatile int *dekker_turn;
+
 // this thread function implements Dekker's Algorithm for two threads.
 // Similarly to Peterson's Algorithm, this approach solves the problem in
 // theory, but does not perform correctly in practice.
@@ -140,29 +621,34 @@ sum_dekker (void *args)
 {
   int id = *((int*)args);
 
-  static volatile int flags[2] = { 0 };
-  static volatile int turn = 0;
-
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += 2)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      flags[id] = 1;
-      while (flags[id ^ 1] == 1)
-        if (turn == (id ^ 1))
+      SLOT(dekker_flags, id) = 1;
+      while (SLOT(dekker_flags, id ^ 1) == 1)
+        if (*dekker_turn == (id ^ 1))
           {
-            flags[id] = 0;
-            while (turn == (id ^ 1));
-            flags[id] = 1;
+            SLOT(dekker_flags, id) = 0;
+            while (*dekker_turn == (id ^ 1));
+            SLOT(dekker_flags, id) = 1;
           }
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      turn = id ^ 1;
-      flags[id] = 0;
+      *dekker_turn = id ^ 1;
+      SLOT(dekker_flags, id) = 0;
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
@@ -175,11 +661,15 @@ bakery_max (volatile long long int *v, size_t n)
   size_t i;
   int res = 0;
   for (i = 0; i < n; ++i)
-    if (v[i] > res)
-      res = v[i];
+    if (SLOT(v, i) > res)
+      res = SLOT(v, i);
   return res;
 }
 
+// shared state of the thread function below
+static volatile int *bakery_choosing;
+static volatile long long int *bakery_num;
+
 // this thread function implements Lamport's Bakery algorithm for two or more
 // threads. This is the first of the software approaches that is implemented
 // here that supports more than two threads. However, this approach does suffer
@@ -194,33 +684,336 @@ sum_bakery (void *args)
 {
   int id = *((int*)args);
 
-  static volatile int choosing[THREADS] = { 0 };
-  static volatile long long int num[THREADS] = { 0 };
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      SLOT(bakery_choosing, id) = 1;
+      SLOT(bakery_num, id) = bakery_max(bakery_num, nthreads) + 1;
+      SLOT(bakery_choosing, id) = 0;
+      int j;
+      for (j = 0; j < (int)nthreads; ++j)
+        {
+          while (SLOT(bakery_choosing, j) == 1);
+          while ((SLOT(bakery_num, j) != 0) && (SLOT(bakery_num, j) < SLOT(bakery_num, id) || (SLOT(bakery_num, j) == SLOT(bakery_num, id) && j < id)));
+        }
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      SLOT(bakery_num, id) = 0;
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+#ifdef HAVE_C11_ATOMICS
+// shared state of the thread function below
+static atomic_int *peterson_fenced_flags;
+static atomic_int *peterson_fenced_turn;
+
+// this thread function implements Peterson's Algorithm like sum_peterson, but
+// uses C11 atomics with the memory ordering the algorithm actually requires.
+// volatile only prevents the compiler from caching variables in registers,
+// but neither the compiler nor the CPU are prevented from reordering the
+// accesses. In particular, the store buffers of x86 CPUs let a thread read the
+// flag of the other thread before its own stores to flag and turn are visible
+// to the other thread, so both threads may enter the critical section.
+//
+// The sequentially consistent fence between the stores and the loads forbids
+// this reordering. Acquire and release ordering make the accesses in the
+// critical section stay inside of it. Since a thread may leave the wait loop
+// through either of its loads, both of them need acquire ordering. Compare
+// the cost of the fence with the cost of test_and_set, which implies the same
+// fence on x86.
+thread_helper_return_t
+sum_peterson_fenced (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      atomic_store_explicit(&SLOT(peterson_fenced_flags, id), 1, memory_order_relaxed);
+      atomic_store_explicit(peterson_fenced_turn, id ^ 1, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      while (atomic_load_explicit(&SLOT(peterson_fenced_flags, id ^ 1), memory_order_acquire) == 1
+             && atomic_load_explicit(peterson_fenced_turn, memory_order_acquire) == (id ^ 1));
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      atomic_store_explicit(&SLOT(peterson_fenced_flags, id), 0, memory_order_release);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below
+static atomic_int *dekker_fenced_flags;
+static atomic_int *dekker_fenced_turn;
+
+// this thread function implements Dekker's Algorithm like sum_dekker, but uses
+// C11 atomics with the memory ordering the algorithm actually requires. Just
+// like Peterson's Algorithm, every store to the own flag must be visible to
+// the other thread before the flag of the other thread is read, which needs a
+// sequentially consistent fence.
+thread_helper_return_t
+sum_dekker_fenced (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      atomic_store_explicit(&SLOT(dekker_fenced_flags, id), 1, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      while (atomic_load_explicit(&SLOT(dekker_fenced_flags, id ^ 1), memory_order_acquire) == 1)
+        if (atomic_load_explicit(dekker_fenced_turn, memory_order_relaxed) == (id ^ 1))
+          {
+            atomic_store_explicit(&SLOT(dekker_fenced_flags, id), 0, memory_order_relaxed);
+            while (atomic_load_explicit(dekker_fenced_turn, memory_order_relaxed) == (id ^ 1));
+            atomic_store_explicit(&SLOT(dekker_fenced_flags, id), 1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+          }
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      atomic_store_explicit(dekker_fenced_turn, id ^ 1, memory_order_release);
+      atomic_store_explicit(&SLOT(dekker_fenced_flags, id), 0, memory_order_release);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this is a helper function used by the fenced Bakery algorithm below.
+static long long int
+bakery_fenced_max (atomic_llong *v, size_t n)
+{
+  size_t i;
+  long long int res = 0;
+  for (i = 0; i < n; ++i)
+    {
+      long long int num = atomic_load_explicit(&SLOT(v, i), memory_order_relaxed);
+      if (num > res)
+        res = num;
+    }
+  return res;
+}
+
+// shared state of the thread function below
+static atomic_int *bakery_fenced_choosing;
+static atomic_llong *bakery_fenced_num;
+
+// this thread function implements Lamport's Bakery algorithm like sum_bakery,
+// but uses C11 atomics with the memory ordering the algorithm actually
+// requires. A thread must publish that it is choosing a number before it
+// reads the numbers of the other threads, and it must publish its number
+// before it reads the choosing flags and numbers of the other threads again,
+// so both steps are followed by a sequentially consistent fence.
+thread_helper_return_t
+sum_bakery_fenced (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      atomic_store_explicit(&SLOT(bakery_fenced_choosing, id), 1, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      long long int num = bakery_fenced_max(bakery_fenced_num, nthreads) + 1;
+      atomic_store_explicit(&SLOT(bakery_fenced_num, id), num, memory_order_relaxed);
+      atomic_store_explicit(&SLOT(bakery_fenced_choosing, id), 0, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      int j;
+      for (j = 0; j < (int)nthreads; ++j)
+        {
+          long long int other;
+          while (atomic_load_explicit(&SLOT(bakery_fenced_choosing, j), memory_order_acquire) == 1);
+          while ((other = atomic_load_explicit(&SLOT(bakery_fenced_num, j), memory_order_acquire)) != 0
+                 && (other < num || (other == num && j < id)));
+        }
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      atomic_store_explicit(&SLOT(bakery_fenced_num, id), 0, memory_order_release);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below
+static atomic_int *filter_level;
+static atomic_int *filter_victim;
+
+// this thread function generalizes Peterson's Algorithm to any number of
+// threads with the filter lock. There are n - 1 levels to pass on the way to
+// the critical section, and at each level, one thread is held back: the last
+// thread to arrive at a level, the victim, waits as long as any other thread
+// is at the same level or above. Like a filter, each level lets at most all
+// but one of the threads trying to pass it through, so that only one thread
+// remains after the last level.
+//
+// Every acquisition passes n - 1 levels, and at each level checks the levels
+// of all other threads, so its cost grows with the square of the number of
+// threads. Compare it with the bakery algorithm for larger numbers of threads.
+thread_helper_return_t
+sum_filter (void *args)
+{
+  int id = *((int*)args);
 
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      choosing[id] = 1;
-      num[id] = bakery_max(num, THREADS) + 1;
-      choosing[id] = 0;
+      int level;
+      for (level = 1; level < (int)nthreads; ++level)
+        {
+          atomic_store_explicit(&SLOT(filter_level, id), level, memory_order_relaxed);
+          atomic_store_explicit(&SLOT(filter_victim, level), id, memory_order_relaxed);
+          atomic_thread_fence(memory_order_seq_cst);
+
+          int waiting = 1;
+          while (waiting && atomic_load_explicit(&SLOT(filter_victim, level), memory_order_acquire) == id)
+            {
+              size_t k;
+              waiting = 0;
+              for (k = 0; k < nthreads && !waiting; ++k)
+                if ((int)k != id && atomic_load_explicit(&SLOT(filter_level, k), memory_order_acquire) >= level)
+                  waiting = 1;
+            }
+        }
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      atomic_store_explicit(&SLOT(filter_level, id), 0, memory_order_release);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below. The tree has one node for every
+// pair of subtrees, numbered like a binary heap, where node k has the
+// children 2k and 2k + 1, and the threads are the leaves size to 2 size - 1.
+// Every node holds the two flags and the turn of a two-thread Peterson lock.
+static atomic_int *tournament_flags;
+static atomic_int *tournament_turn;
+static size_t tournament_size;
+static int tournament_levels;
+
+// this thread function builds a lock for any number of threads from the
+// fenced two-thread Peterson locks above, arranged as a binary tree. Starting
+// from its leaf, a thread competes with the winner of the neighbouring subtree
+// for each node on the way up to the root, like in a tournament, and the
+// winner of the root enters the critical section. On leaving, the thread
+// releases the nodes from the root downwards, so that at any time, at most one
+// thread from each side competes for a node.
+//
+// An acquisition passes only log2(n) nodes, and at each node only looks at a
+// single other thread, so it scales much better than the filter lock or the
+// bakery algorithm.
+thread_helper_return_t
+sum_tournament (void *args)
+{
+  int id = *((int*)args);
+  size_t leaf = tournament_size + id;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
       int j;
-      for (j = 0; j < THREADS; ++j)
+
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      for (j = 0; j < tournament_levels; ++j)
         {
-          while (choosing[j] == 1);
-          while ((num[j] != 0) && (num[j] < num[id] || (num[j] == num[id] && j < id)));
+          size_t node = leaf >> (j + 1);
+          int side = (leaf >> j) & 1;
+          atomic_store_explicit(&SLOT(tournament_flags, 2 * node + side), 1, memory_order_relaxed);
+          atomic_store_explicit(&SLOT(tournament_turn, node), side ^ 1, memory_order_relaxed);
+          atomic_thread_fence(memory_order_seq_cst);
+          while (atomic_load_explicit(&SLOT(tournament_flags, 2 * node + (side ^ 1)), memory_order_acquire) == 1
+                 && atomic_load_explicit(&SLOT(tournament_turn, node), memory_order_acquire) == (side ^ 1));
         }
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      num[id] = 0;
+      for (j = tournament_levels - 1; j >= 0; --j)
+        atomic_store_explicit(&SLOT(tournament_flags, 2 * (leaf >> (j + 1)) + ((leaf >> j) & 1)), 0, memory_order_release);
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
+#endif
+
+// shared state of the thread function below
+static int *test_and_set_flag;
 
 // this thread function attempts to solve the critical section problem by using
 // the atomic hardware instruction test_and_set. By delegating this problem
@@ -236,151 +1029,1705 @@ sum_test_and_set (void *args)
 {
   int id = *((int*)args);
 
-  static int lock = 0;
-
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      while (thread_helper_test_and_set_lock(&lock)) {
-        while (lock);
-      }
+      if (try_mode)
+        TRY_LOCK(thread_helper_test_and_set_lock(test_and_set_flag),
+                 thread_helper_test_and_set_timedlock(test_and_set_flag, try_deadline()));
+      else
+        while (thread_helper_test_and_set_lock(test_and_set_flag)) {
+          while (*test_and_set_flag);
+        }
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      thread_helper_test_and_set_unlock(&lock);
+      thread_helper_test_and_set_unlock(test_and_set_flag);
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
-// a shared mutex for the thread function below
-thread_helper_mutex_t mutex;
+// shared state of the thread function below
+static int *ttas_flag;
 
-// this thread function syncronizes the critical section by using operating
-// system APIs. These APIs internally syncronize the participating threads
-// using hardware constructs, like test_and_set, but instead of doing busy
-// waiting they will implement the waiting by making scheduling decisions,
-// evacuating threads blocked by a locked mutex from the CPU and making space
-// for other threads instead.
+// this thread function improves on test_and_set by only attempting the atomic
+// instruction once a plain read has seen the lock released, and by backing
+// off for a random, exponentially growing time after every failed attempt.
+// The atomic instruction requires exclusive ownership of the cache line, so
+// with test_and_set every waiting thread keeps moving the cache line between
+// the CPUs, even while the lock is held. Here, waiting threads only read from
+// their own caches until the lock is released.
 //
-// This is usually the most efficient construct to use, and the easiest to get
-// right without any caveats.
+// Compare the results with different bounds of the backoff, to see how much
+// of the cost of test_and_set is caused by this traffic between the CPUs.
 thread_helper_return_t
-sum_semaphore (void *args)
+sum_ttas (void *args)
 {
   int id = *((int*)args);
 
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  thread_helper_backoff_t backoff;
+  thread_helper_backoff_init(&backoff, backoff_min, backoff_max, id + 1);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      thread_helper_mutex_lock(&mutex);
+      if (try_mode)
+        TRY_LOCK(thread_helper_test_and_set_lock(ttas_flag),
+                 thread_helper_test_and_test_and_set_timedlock(ttas_flag, &backoff, try_deadline()));
+      else
+        thread_helper_test_and_test_and_set_lock(ttas_flag, &backoff);
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      thread_helper_mutex_unlock(&mutex);
+      thread_helper_test_and_set_unlock(ttas_flag);
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
-// this function is a blank space for you to experiment with your own
-// solutions. Be creative, but remember that solutions only based in software
-// have been shown above to fail in non-trivial ways.
+// shared state of the thread function below
+static thread_helper_ticket_lock_t *ticket_lock;
+
+// this thread function uses a ticket lock, built on the atomic hardware
+// instruction fetch_and_add. Like the Bakery Algorithm, the ticket lock lets
+// the threads enter the critical section in the order of their arrival, so no
+// thread can starve, which is not guaranteed by test_and_set. In contrast to
+// the Bakery Algorithm, drawing a ticket is a single atomic instruction, and
+// does not require scanning the numbers of all other threads.
+//
+// However, all waiting threads still spin on the same shared counter, which
+// is invalidated in the caches of all of them on every unlock.
 thread_helper_return_t
-sum_custom (void *args)
+sum_ticket (void *args)
 {
   int id = *((int*)args);
 
-  unsigned long i;
-  for (i = id; i <= SUM_TO; i += THREADS)
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
     {
+      STATS_ACQUIRE();
       /* enter critical section *********************************************/
-      // TODO!
+      if (try_mode)
+        TRY_LOCK(thread_helper_ticket_trylock(ticket_lock),
+                 thread_helper_ticket_timedlock(ticket_lock, try_deadline()));
+      else
+        thread_helper_ticket_lock(ticket_lock);
       /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
 
-      res += i;
+      *res += i;
+      WORK_INSIDE();
 
+      CHECK_LEAVE();
+      STATS_RELEASE();
       /* leave critical section *********************************************/
-      // TODO!
+      thread_helper_ticket_unlock(ticket_lock);
       /**********************************************************************/
+
+      WORK_OUTSIDE();
     }
 
   return 0;
 }
 
-// the code below chooses the active guard type from the funtions above by
-// checking the preprocessor macros passed in the GNUMakefile.
-struct guard_type_t
+// shared state of the thread function below. Each thread owns one node of the
+// queue, aligned to its own cache line.
+static thread_helper_mcs_lock_t mcs_lock;
+static thread_helper_mcs_node_t mcs_nodes[MAX_THREADS];
+
+// this thread function uses an MCS queue lock. Waiting threads form a queue,
+// and each thread spins on the node it owns, instead of on a shared variable.
+// Handing the lock over to the next thread in the queue only invalidates the
+// cache line of that thread, so the cost of an unlock does not grow with the
+// number of waiting threads, as it does for test_and_set and the ticket lock.
+thread_helper_return_t
+sum_mcs (void *args)
 {
-  thread_func_t func;
-  const char *name;
-  size_t max_threads;
-};
+  int id = *((int*)args);
 
-static const struct guard_type_t guard =
-#if defined(HAVE_UNGUARDED)
-  { sum_unguarded, "unguarded", 0 };
-#elif defined(HAVE_TURNS)
-  { sum_turns, "take turns", 2 };
+  thread_helper_mcs_node_t *node = mcs_nodes + id;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      if (try_mode)
+        TRY_LOCK(thread_helper_mcs_trylock(&mcs_lock, node),
+                 thread_helper_mcs_timedlock(&mcs_lock, node, try_deadline()));
+      else
+        thread_helper_mcs_lock(&mcs_lock, node);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_mcs_unlock(&mcs_lock, node);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below. The queue needs one more node
+// than there are threads, because it always contains the node of the last
+// thread that released the lock.
+static thread_helper_clh_lock_t clh_lock;
+static thread_helper_clh_node_t clh_nodes[MAX_THREADS + 1];
+
+// this thread function uses a CLH queue lock. Like the MCS lock, every waiting
+// thread spins on a different cache line, but here each thread spins on the
+// node of its predecessor, and the nodes move between the threads as the lock
+// is passed along.
+thread_helper_return_t
+sum_clh (void *args)
+{
+  int id = *((int*)args);
+
+  thread_helper_clh_node_t *node = clh_nodes + id + 1;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      thread_helper_clh_lock(&clh_lock, &node);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_clh_unlock(&clh_lock, &node);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// a shared mutex for the thread function below
+thread_helper_mutex_t mutex;
+
+// this thread function syncronizes the critical section by using operating
+// system APIs. These APIs internally syncronize the participating threads
+// using hardware constructs, like test_and_set, but instead of doing busy
+// waiting they will implement the waiting by making scheduling decisions,
+// evacuating threads blocked by a locked mutex from the CPU and making space
+// for other threads instead.
+//
+// This is usually the most efficient construct to use, and the easiest to get
+// right without any caveats.
+thread_helper_return_t
+sum_semaphore (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      if (try_mode)
+        TRY_LOCK(thread_helper_mutex_trylock(&mutex),
+                 thread_helper_mutex_timedlock(&mutex, try_deadline()));
+      else
+        thread_helper_mutex_lock(&mutex);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_mutex_unlock(&mutex);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+#ifdef THREAD_HELPER_HAVE_FUTEX
+// a shared mutex for the thread function below, implemented on futexes
+thread_helper_mutex_t futex_mutex;
+
+// this thread function is identical to the one above, but uses a mutex that
+// is implemented directly on top of the futex system call of Linux, instead
+// of the mutex of the operating system library. This makes the cost of the
+// system calls visible: the mutex counts how often threads went to sleep and
+// were woken up, which only happens when the mutex is contended.
+thread_helper_return_t
+sum_futex (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      if (try_mode)
+        TRY_LOCK(thread_helper_mutex_trylock(&futex_mutex),
+                 thread_helper_mutex_timedlock(&futex_mutex, try_deadline()));
+      else
+        thread_helper_mutex_lock(&futex_mutex);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_mutex_unlock(&futex_mutex);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function prints the number of system calls made by the function above
+static void
+report_futex (void)
+{
+  long waits, wakes;
+  thread_helper_mutex_syscalls(&futex_mutex, &waits, &wakes);
+  printf("futex waits:   %20ld\n", waits);
+  printf("futex wakes:   %20ld\n", wakes);
+}
+#endif
+
+// shared state of the thread function below
+static thread_helper_adaptive_lock_t adaptive_lock;
+
+// this thread function uses an adaptive lock, that spins for a while before
+// parking a waiting thread in the kernel. Spin-locks like test_and_set waste
+// whole scheduling quanta when the lock holder is not running, e.g. when all
+// threads share a single CPU, while mutexes pay for system calls even when
+// the lock would have been released a moment later. The adaptive lock tunes
+// the time it spins to the recent hold times of the lock.
+//
+// Compare the results running in parallel on multiple CPUs and concurrently
+// on a single CPU, together with the spin-locks and the semaphore.
+thread_helper_return_t
+sum_adaptive (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      if (try_mode)
+        TRY_LOCK(thread_helper_adaptive_trylock(&adaptive_lock),
+                 thread_helper_adaptive_timedlock(&adaptive_lock, try_deadline()));
+      else
+        thread_helper_adaptive_lock(&adaptive_lock);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_adaptive_unlock(&adaptive_lock);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function prints how often threads were parked by the function above,
+// and the number of spin iterations the lock has tuned itself to
+static void
+report_adaptive (void)
+{
+  printf("parks:         %20ld\n", adaptive_lock.parks);
+  printf("spin estimate: %20ld\n", adaptive_lock.spin_estimate);
+}
+
+// shared state of the thread function below. The NUMA node of each thread is
+// set by the thread itself before the start barrier, from the topology of the
+// system.
+static thread_helper_cohort_lock_t cohort_lock;
+static int cohort_nodes[MAX_THREADS];
+
+// this thread function uses a cohort lock, made of one local lock per NUMA
+// node and a global lock. On machines with multiple sockets, a global lock
+// like test_and_set or the semaphore moves its cache line, and the shared
+// variable, across the interconnect on nearly every handoff. The cohort lock
+// instead passes the global lock on to waiting threads of the same node, up to
+// a bound that keeps the other nodes from starving.
+//
+// Compare the cross-node handoffs and the throughput at full machine width,
+// together with the semaphore, and with --cohort-bound 0, which hands the lock
+// to another node on every release.
+thread_helper_return_t
+sum_cohort (void *args)
+{
+  int id = *((int*)args);
+  int node = cohort_nodes[id];
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      thread_helper_cohort_lock(&cohort_lock, node);
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      thread_helper_cohort_unlock(&cohort_lock, node);
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function prints the node of each thread, how often the function above
+// passed the lock on within a node, and how often it moved between nodes
+static void
+report_cohort (void)
+{
+  size_t t;
+  printf("nodes:        ");
+  for (t = 0; t < nthreads; ++t)
+    printf(" %d", cohort_nodes[t]);
+  printf("\n");
+  printf("local handoffs:%20ld\n", cohort_lock.local_handoffs);
+  printf("global handoffs:%19ld\n", cohort_lock.global_handoffs);
+  printf("cross-node:    %20ld\n", cohort_lock.cross_node_handoffs);
+  printf("cross-node/s:  %17.0f\n", experiment_ns ? cohort_lock.cross_node_handoffs * 1e9 / experiment_ns : 0.0);
+}
+
+// shared state of the thread function below. Every thread publishes its
+// pending addend in its own cache line aligned slot.
+struct THREAD_HELPER_CACHE_ALIGNED combining_slot_t
+{
+  volatile int pending;
+  unsigned long long value;
+};
+
+static struct combining_slot_t combining_slots[MAX_THREADS];
+static int combining_flag;
+static long combining_passes;
+
+// this thread function uses flat combining. The critical section of this
+// exercise is a single addition, so with any of the guards above, the cost of
+// handing the lock from thread to thread dominates the cost of the work done
+// while holding it. With flat combining, a thread does not lock the shared
+// variable itself, but publishes its addend in its slot, and then waits until
+// it has been applied. Whichever waiting thread manages to acquire the
+// combiner lock sweeps the slots of all threads, and applies all pending
+// addends in one pass, while the shared variable stays in its cache.
+//
+// Compare the number of combining passes to the number of critical section
+// entries, which tells the average size of a batch.
+thread_helper_return_t
+sum_combining (void *args)
+{
+  int id = *((int*)args);
+  struct combining_slot_t *slot = &combining_slots[id];
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      slot->value = i;
+      thread_helper_store_release(&slot->pending, 1);
+
+      while (thread_helper_load_acquire(&slot->pending))
+        {
+          if (thread_helper_load_acquire(&combining_flag)
+              || thread_helper_test_and_set_lock(&combining_flag))
+            {
+              thread_helper_cpu_relax();
+              continue;
+            }
+
+          /* enter critical section *****************************************/
+          CHECK_ENTER();
+          size_t t;
+          for (t = 0; t < nthreads; ++t)
+            if (thread_helper_load_acquire(&combining_slots[t].pending))
+              {
+                *res += combining_slots[t].value;
+                WORK_INSIDE();
+                thread_helper_store_release(&combining_slots[t].pending, 0);
+              }
+          combining_passes++;
+          CHECK_LEAVE();
+          /******************************************************************/
+
+          /* leave critical section *****************************************/
+          thread_helper_test_and_set_unlock(&combining_flag);
+          /******************************************************************/
+        }
+
+      // the wait ends when the addend has been applied, by this thread or by
+      // another one, and there is nothing left to hold
+      STATS_ACQUIRED();
+      STATS_RELEASE();
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function prints the number of combining passes made by the function
+// above, and the average number of addends applied in each of them
+static void
+report_combining (void)
+{
+  printf("passes:        %20ld\n", combining_passes);
+  printf("batch size:    %20.2f\n", combining_passes ? (double)(sum_to + 1) / combining_passes : 0.0);
+}
+
+// shared state of the two thread functions below. The synchronous variant
+// uses the same cache line aligned slots as flat combining, the asynchronous
+// variant a ring of requests, where each entry carries a sequence number that
+// tells whether it is free, or holds a request of the given position.
+#define DELEGATION_RING 1024
+
+struct delegation_entry_t
+{
+  volatile unsigned long long sequence;
+  unsigned long long value;
+};
+
+static struct combining_slot_t delegation_slots[MAX_THREADS];
+static struct delegation_entry_t delegation_ring[DELEGATION_RING];
+static THREAD_HELPER_CACHE_ALIGNED volatile unsigned long long delegation_tail;
+static long delegation_sweeps;
+
+// this function adds the addends of the server thread itself, interleaved
+// with serving the requests of the clients in the thread functions below
+static unsigned long long
+delegation_own (int id, unsigned long long i)
+{
+  if (i <= sum_to)
+    {
+      STATS_ACQUIRE();
+      STATS_ACQUIRED();
+      *res += i;
+      WORK_INSIDE();
+      STATS_RELEASE();
+      WORK_OUTSIDE();
+      i += nthreads;
+    }
+  return i;
+}
+
+// this thread function uses delegation. Like with flat combining, a thread
+// does not lock the shared variable itself, but publishes its addend in its
+// slot, and then waits until it has been applied. Unlike flat combining, the
+// addends are always applied by the same thread, the server thread with id 0,
+// which is the only one ever to touch the shared variable, so that it never
+// leaves the cache of the server's CPU, and no lock is needed at all. The
+// server sweeps the slots of all clients until it has applied all addends.
+thread_helper_return_t
+sum_delegation (void *args)
+{
+  int id = *((int*)args);
+
+  if (id == 0)
+    {
+      unsigned long long own = 0, applied = 0;
+      while (applied <= sum_to)
+        {
+          /* enter critical section *****************************************/
+          size_t t;
+          long batch = 0;
+          for (t = 1; t < nthreads; ++t)
+            if (thread_helper_load_acquire(&delegation_slots[t].pending))
+              {
+                *res += delegation_slots[t].value;
+                WORK_INSIDE();
+                thread_helper_store_release(&delegation_slots[t].pending, 0);
+                ++batch;
+              }
+          /******************************************************************/
+
+          if (batch)
+            delegation_sweeps++;
+          else
+            thread_helper_cpu_relax();
+          if (own <= sum_to)
+            {
+              own = delegation_own(id, own);
+              ++batch;
+            }
+          applied += batch;
+        }
+      return 0;
+    }
+
+  struct combining_slot_t *slot = &delegation_slots[id];
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      slot->value = i;
+      thread_helper_store_release(&slot->pending, 1);
+      while (thread_helper_load_acquire(&slot->pending))
+        thread_helper_cpu_relax();
+
+      // the wait ends when the server has applied the addend, and there is
+      // nothing left to hold
+      STATS_ACQUIRED();
+      STATS_RELEASE();
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this thread function uses asynchronous delegation. Instead of waiting in
+// their own slots, the clients append their addends to a shared ring with a
+// single fetch_and_add, and continue right away without waiting for the
+// server to apply them. A client only has to wait if the ring is full. The
+// server takes the requests out of the ring in order, and finishes once it has
+// applied all addends.
+//
+// Observe that the clients now contend for the tail of the ring instead of a
+// lock, but the shared variable itself still stays with the server.
+thread_helper_return_t
+sum_delegation_async (void *args)
+{
+  int id = *((int*)args);
+
+  if (id == 0)
+    {
+      unsigned long long own = 0, applied = 0, head = 0;
+      while (applied <= sum_to)
+        {
+          /* enter critical section *****************************************/
+          long batch = 0;
+          struct delegation_entry_t *entry = &delegation_ring[head % DELEGATION_RING];
+          while (thread_helper_load_acquire_64(&entry->sequence) == head + 1)
+            {
+              *res += entry->value;
+              WORK_INSIDE();
+              thread_helper_store_release_64(&entry->sequence, head + DELEGATION_RING);
+              ++batch;
+              entry = &delegation_ring[++head % DELEGATION_RING];
+            }
+          /******************************************************************/
+
+          if (batch)
+            delegation_sweeps++;
+          else
+            thread_helper_cpu_relax();
+          if (own <= sum_to)
+            {
+              own = delegation_own(id, own);
+              ++batch;
+            }
+          applied += batch;
+        }
+      return 0;
+    }
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      unsigned long long tail = thread_helper_fetch_and_add(&delegation_tail, 1);
+      struct delegation_entry_t *entry = &delegation_ring[tail % DELEGATION_RING];
+      // the entry is free for this position once the server has taken the
+      // request of the previous round. The difference is compared as a signed
+      // value, so that it stays correct when the counters wrap around.
+      while ((long long)(thread_helper_load_acquire_64(&entry->sequence) - tail) < 0)
+        thread_helper_cpu_relax();
+      entry->value = i;
+      thread_helper_store_release_64(&entry->sequence, tail + 1);
+
+      // the request has been posted, which is all a client waits for
+      STATS_ACQUIRED();
+      STATS_RELEASE();
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function prints the number of sweeps made by the server thread of the
+// functions above that found pending requests, and the average number of
+// requests it applied in each of them
+static void
+report_delegation (void)
+{
+  unsigned long long requests = nthreads > 1 ? sum_to + 1 - (sum_to / nthreads + 1) : 0;
+  printf("sweeps:        %20ld\n", delegation_sweeps);
+  printf("batch size:    %20.2f\n", delegation_sweeps ? (double)requests / delegation_sweeps : 0.0);
+}
+
+// this thread function does without mutual exclusion, and adds to the shared
+// variable with the atomic hardware instruction fetch_and_add instead. No
+// thread ever waits for another one to leave a critical section, but the cache
+// line of the shared variable still moves from CPU to CPU on every addition.
+// This is the upper bound that every lock protecting a single counter should
+// be judged against.
+thread_helper_return_t
+sum_atomic (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      // no-op
+      /**********************************************************************/
+      STATS_ACQUIRED();
+
+      thread_helper_fetch_and_add(res, i);
+      WORK_INSIDE();
+
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      // no-op
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below. Every thread owns one counter,
+// placed on its own cache line.
+struct THREAD_HELPER_CACHE_ALIGNED sharded_counter_t
+{
+  volatile unsigned long long value;
+};
+
+static struct sharded_counter_t sharded_counters[MAX_THREADS];
+
+// this thread function splits the shared variable into one counter per
+// thread. Every thread only adds to its own counter, so neither atomic
+// instructions nor locks are needed, and the cache lines stay with their
+// CPUs. The price is paid when the counter is read, which has to sum up the
+// counters of all threads, as done by the function below.
+thread_helper_return_t
+sum_sharded (void *args)
+{
+  int id = *((int*)args);
+  struct sharded_counter_t *counter = &sharded_counters[id];
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      // no-op
+      /**********************************************************************/
+      STATS_ACQUIRED();
+
+      counter->value += i;
+      WORK_INSIDE();
+
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      // no-op
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function reads the sharded counter of the function above, by folding
+// the counters of all threads into the shared variable
+static void
+collect_sharded (void)
+{
+  size_t t;
+  for (t = 0; t < nthreads; ++t)
+    *res += sharded_counters[t].value;
+}
+
+// this thread function accumulates its part of the sum in a local variable,
+// which the compiler keeps in a register, and publishes it to the shared
+// variable only once, when it is done. This is the reduction pattern used by
+// parallel programming frameworks, and shows what the computation costs when
+// the threads do not communicate at all.
+thread_helper_return_t
+sum_local (void *args)
+{
+  int id = *((int*)args);
+  unsigned long long local = 0;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      local += i;
+      WORK_OUTSIDE();
+    }
+
+  /* enter critical section *************************************************/
+  // no-op
+  /**************************************************************************/
+
+  thread_helper_fetch_and_add(res, local);
+
+  /* leave critical section *************************************************/
+  // no-op
+  /**************************************************************************/
+
+  return 0;
+}
+
+// the read-mostly workload of the reader-writer guards below. Only a part of
+// the operations of a thread, given by the write ratio, modify the shared
+// variable, while the others only read it, together with the shared data of
+// the --cs-lines option. To still arrive at the expected sum, the numbers of
+// the reading operations are collected by the thread, and added by its next
+// writing operation. The last operation of every thread is always a writing
+// one.
+struct THREAD_HELPER_CACHE_ALIGNED rw_counts_t
+{
+  unsigned long long reads;
+  unsigned long long writes;
+  unsigned long long retries;
+};
+
+static struct rw_counts_t rw_counts[MAX_THREADS];
+
+// this function decides whether the operation of the given thread for the
+// given number modifies the shared variable.
+static int
+rw_is_write (int id, unsigned long long i)
+{
+  if (i + nthreads > sum_to || write_ratio >= 100 || work_random(&work_states[id]) % 100 < write_ratio)
+    {
+      rw_counts[id].writes++;
+      return 1;
+    }
+  rw_counts[id].reads++;
+  return 0;
+}
+
+// this function reads the shared variable and the shared data, and returns
+// the sum of the values read. It must be called while holding the guard for
+// reading, or its result must only be kept once the read was found consistent.
+static unsigned long long
+rw_read (int id)
+{
+  struct work_state_t *state = &work_states[id];
+  unsigned long n = work_amount(state, work_cs_lines), l;
+  unsigned long long x = *res;
+  for (l = 0; l < n; ++l)
+    x += work_data[(l % WORK_MAX_LINES) * (THREAD_HELPER_CACHE_LINE / sizeof(unsigned long long))];
+  return x;
+}
+
+// this function prints the number of reading and writing operations of the
+// reader-writer guards below, and the rate of the reading operations
+static void
+report_rw (void)
+{
+  unsigned long long reads = 0, writes = 0, retries = 0;
+  size_t t;
+  for (t = 0; t < nthreads; ++t)
+    {
+      reads += rw_counts[t].reads;
+      writes += rw_counts[t].writes;
+      retries += rw_counts[t].retries;
+    }
+  printf("reads:         %20llu\n", reads);
+  printf("writes:        %20llu\n", writes);
+  if (retries)
+    printf("read retries:  %20llu\n", retries);
+  printf("read rate:     %17.0f reads/s\n", experiment_ns ? reads * 1e9 / experiment_ns : 0.0);
+}
+
+// shared state of the thread function below
+static thread_helper_rwlock_t rwlock;
+
+// this thread function uses the reader-writer lock of the operating system.
+// Readers may hold the lock at the same time, so with a low write ratio, the
+// threads no longer wait for each other most of the time. They still modify
+// the state of the lock on every operation though.
+thread_helper_return_t
+sum_rwlock (void *args)
+{
+  int id = *((int*)args);
+  unsigned long long pending = 0;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      pending += i;
+      if (!rw_is_write(id, i))
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for reading *****************************/
+          thread_helper_rwlock_read_lock(&rwlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_READ_ENTER();
+
+          work_states[id].sink += rw_read(id);
+
+          CHECK_READ_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_rwlock_read_unlock(&rwlock);
+          /******************************************************************/
+        }
+      else
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for writing *****************************/
+          thread_helper_rwlock_write_lock(&rwlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_ENTER();
+
+          *res += pending;
+          WORK_INSIDE();
+
+          CHECK_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_rwlock_write_unlock(&rwlock);
+          /******************************************************************/
+          pending = 0;
+        }
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below
+static thread_helper_spin_rwlock_t spin_rwlock;
+
+// this thread function uses a reader-writer spin-lock that prefers writers:
+// once a writer waits for the lock, arriving readers wait until it is done.
+// All readers increment and decrement the same counter, so its cache line
+// still moves between the CPUs on every read.
+thread_helper_return_t
+sum_spin_rwlock (void *args)
+{
+  int id = *((int*)args);
+  unsigned long long pending = 0;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      pending += i;
+      if (!rw_is_write(id, i))
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for reading *****************************/
+          thread_helper_spin_rwlock_read_lock(&spin_rwlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_READ_ENTER();
+
+          work_states[id].sink += rw_read(id);
+
+          CHECK_READ_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_spin_rwlock_read_unlock(&spin_rwlock);
+          /******************************************************************/
+        }
+      else
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for writing *****************************/
+          thread_helper_spin_rwlock_write_lock(&spin_rwlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_ENTER();
+
+          *res += pending;
+          WORK_INSIDE();
+
+          CHECK_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_spin_rwlock_write_unlock(&spin_rwlock);
+          /******************************************************************/
+          pending = 0;
+        }
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below. Every thread owns one slot,
+// aligned to its own cache line.
+static thread_helper_brlock_t brlock;
+static thread_helper_brlock_slot_t brlock_slots[MAX_THREADS];
+
+// this thread function uses a big reader lock, where every reader only marks
+// its own slot as active. Readers never write to a cache line shared with
+// other threads, so reading scales with the number of CPUs, while writers
+// have to wait for the slots of all threads.
+//
+// Compare the read rate of the reader-writer guards for different numbers of
+// threads and different write ratios, e.g. --write-ratio 1 and 50.
+thread_helper_return_t
+sum_brlock (void *args)
+{
+  int id = *((int*)args);
+  unsigned long long pending = 0;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      pending += i;
+      if (!rw_is_write(id, i))
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for reading *****************************/
+          thread_helper_brlock_read_lock(&brlock, id);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_READ_ENTER();
+
+          work_states[id].sink += rw_read(id);
+
+          CHECK_READ_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_brlock_read_unlock(&brlock, id);
+          /******************************************************************/
+        }
+      else
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for writing *****************************/
+          thread_helper_brlock_write_lock(&brlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_ENTER();
+
+          *res += pending;
+          WORK_INSIDE();
+
+          CHECK_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_brlock_write_unlock(&brlock);
+          /******************************************************************/
+          pending = 0;
+        }
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// shared state of the thread function below
+static thread_helper_seqlock_t seqlock;
+
+// this thread function uses a sequence lock. Readers do not lock at all, and
+// do not write to any shared memory: they read the shared variable
+// optimistically, and only check afterwards whether a writer modified it in
+// the meantime, in which case they read it again. Reading therefore scales
+// with the number of CPUs like the unguarded accesses, as long as writes are
+// rare, while writers exclude each other with a spin-lock.
+//
+// Compare the read rate and the read retries with the other reader-writer
+// guards, for different numbers of threads and write ratios.
+thread_helper_return_t
+sum_seqlock (void *args)
+{
+  int id = *((int*)args);
+  unsigned long long pending = 0;
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      pending += i;
+      if (!rw_is_write(id, i))
+        {
+          STATS_ACQUIRE();
+          for (;;)
+            {
+              /* begin optimistic read **************************************/
+              unsigned sequence = thread_helper_seqlock_read_begin(&seqlock);
+              /**************************************************************/
+
+              unsigned long long value = rw_read(id);
+
+              /* retry if a writer interfered *******************************/
+              if (!thread_helper_seqlock_read_retry(&seqlock, sequence))
+                {
+                  work_states[id].sink += value;
+                  break;
+                }
+              rw_counts[id].retries++;
+              /**************************************************************/
+            }
+          STATS_ACQUIRED();
+          STATS_RELEASE();
+        }
+      else
+        {
+          STATS_ACQUIRE();
+          /* enter critical section for writing *****************************/
+          thread_helper_seqlock_write_lock(&seqlock);
+          /******************************************************************/
+          STATS_ACQUIRED();
+          CHECK_ENTER();
+
+          *res += pending;
+          WORK_INSIDE();
+
+          CHECK_LEAVE();
+          STATS_RELEASE();
+          /* leave critical section *****************************************/
+          thread_helper_seqlock_write_unlock(&seqlock);
+          /******************************************************************/
+          pending = 0;
+        }
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function is a blank space for you to experiment with your own
+// solutions. Be creative, but remember that solutions only based in software
+// have been shown above to fail in non-trivial ways.
+thread_helper_return_t
+sum_custom (void *args)
+{
+  int id = *((int*)args);
+
+  unsigned long long i;
+  for (i = id; i <= sum_to; i += nthreads)
+    {
+      STATS_ACQUIRE();
+      /* enter critical section *********************************************/
+      // TODO!
+      /**********************************************************************/
+      STATS_ACQUIRED();
+      CHECK_ENTER();
+
+      *res += i;
+      WORK_INSIDE();
+
+      CHECK_LEAVE();
+      STATS_RELEASE();
+      /* leave critical section *********************************************/
+      // TODO!
+      /**********************************************************************/
+
+      WORK_OUTSIDE();
+    }
+
+  return 0;
+}
+
+// this function resets the shared state of all guard types above, so that
+// multiple experiments can be run one after another in the same process.
+static void
+reset_experiment (void)
+{
+  // clear the shared area, and place the shared variable and the shared state
+  // of each guard type in it, according to the selected layout
+  memset(shared_area, 0, sizeof(shared_area));
+  shared_used = 0;
+  res = shared_alloc(sizeof(*res), 1);
+
+  size_t base = shared_used;
+  turns_turn = shared_alloc(sizeof(*turns_turn), 1);
+  shared_used = base;
+  flags_raised = shared_alloc(sizeof(*flags_raised), 2);
+  shared_used = base;
+  peterson_flags = shared_alloc(sizeof(*peterson_flags), 2);
+  peterson_turn = shared_alloc(sizeof(*peterson_turn), 1);
+  shared_used = base;
+  dekker_flags = shared_alloc(sizeof(*dekker_flags), 2);
+  dekker_turn = shared_alloc(sizeof(*dekker_turn), 1);
+  shared_used = base;
+  bakery_choosing = shared_alloc(sizeof(*bakery_choosing), nthreads);
+  bakery_num = shared_alloc(sizeof(*bakery_num), nthreads);
+#ifdef HAVE_C11_ATOMICS
+  shared_used = base;
+  peterson_fenced_flags = shared_alloc(sizeof(*peterson_fenced_flags), 2);
+  peterson_fenced_turn = shared_alloc(sizeof(*peterson_fenced_turn), 1);
+  shared_used = base;
+  dekker_fenced_flags = shared_alloc(sizeof(*dekker_fenced_flags), 2);
+  dekker_fenced_turn = shared_alloc(sizeof(*dekker_fenced_turn), 1);
+  shared_used = base;
+  bakery_fenced_choosing = shared_alloc(sizeof(*bakery_fenced_choosing), nthreads);
+  bakery_fenced_num = shared_alloc(sizeof(*bakery_fenced_num), nthreads);
+  shared_used = base;
+  filter_level = shared_alloc(sizeof(*filter_level), nthreads);
+  filter_victim = shared_alloc(sizeof(*filter_victim), nthreads);
+  shared_used = base;
+  for (tournament_size = 1, tournament_levels = 0; tournament_size < nthreads; tournament_size *= 2)
+    ++tournament_levels;
+  tournament_flags = shared_alloc(sizeof(*tournament_flags), 2 * tournament_size);
+  tournament_turn = shared_alloc(sizeof(*tournament_turn), tournament_size);
+#endif
+  shared_used = base;
+  test_and_set_flag = shared_alloc(sizeof(*test_and_set_flag), 1);
+  shared_used = base;
+  ttas_flag = shared_alloc(sizeof(*ttas_flag), 1);
+  shared_used = base;
+  ticket_lock = shared_alloc(sizeof(*ticket_lock), 1);
+  thread_helper_ticket_init(ticket_lock);
+
+  // the remaining guard types keep their state outside of the shared area
+  thread_helper_mcs_init(&mcs_lock);
+  thread_helper_clh_init(&clh_lock, clh_nodes);
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  thread_helper_mutex_init_type(&futex_mutex, THREAD_HELPER_MUTEX_FUTEX);
+#endif
+  adaptive_lock.state = 0;
+  adaptive_lock.spin_estimate = 0;
+  adaptive_lock.parks = 0;
+  thread_helper_cohort_init(&cohort_lock, cohort_bound);
+  memset(sharded_counters, 0, sizeof(sharded_counters));
+  memset(combining_slots, 0, sizeof(combining_slots));
+  memset(delegation_slots, 0, sizeof(delegation_slots));
+  delegation_tail = 0;
+  delegation_sweeps = 0;
+  memset(rw_counts, 0, sizeof(rw_counts));
+  memset(try_counts, 0, sizeof(try_counts));
+  thread_helper_spin_rwlock_init(&spin_rwlock);
+  thread_helper_brlock_init(&brlock, brlock_slots, nthreads);
+  thread_helper_seqlock_init(&seqlock);
+  memset((void*)work_data, 0, sizeof(work_data));
+  size_t t;
+  for (t = 0; t < MAX_THREADS; ++t)
+    {
+      work_states[t].seed = 0x9e3779b97f4a7c15ULL * (t + 1);
+      work_states[t].sink = t;
+    }
+  for (t = 0; t < DELEGATION_RING; ++t)
+    delegation_ring[t].sequence = t;
+#ifdef HAVE_STATS
+  memset(stats, 0, sizeof(stats));
+  stats_first_done = 0;
+#endif
+#ifdef HAVE_CHECK
+  check_occupancy = 0;
+  check_violations = 0;
+#endif
+  combining_flag = 0;
+  combining_passes = 0;
+}
+
+// the table below lists all available guard types, together with the short
+// key used to select them on the command line, a descriptive name, and the
+// maximum number of threads supported by the guard, or 0 if there is no limit.
+// Guard types that collect additional statistics provide a function to print
+// them after each experiment, and guard types that keep the sum outside of the
+// shared variable provide a function to fold it into the shared variable after
+// the threads have been joined. The last column tells whether the guard
+// supports the --try-timeout option.
+struct guard_type_t
+{
+  thread_func_t func;
+  const char *key;
+  const char *name;
+  size_t max_threads;
+  void (*report)(void);
+  void (*collect)(void);
+  int try_lock;
+};
+
+static const struct guard_type_t guards[] =
+{
+  { sum_unguarded, "unguarded", "unguarded", 0, NULL, NULL, 0 },
+  { sum_turns, "turns", "take turns", 2, NULL, NULL, 0 },
+  { sum_flags, "flags", "raise flags", 2, NULL, NULL, 0 },
+  { sum_peterson, "peterson", "Peterson's Algorithm", 2, NULL, NULL, 0 },
+  { sum_dekker, "dekker", "Dekker's Algorithm", 2, NULL, NULL, 0 },
+  { sum_bakery, "bakery", "Bakery Algorithm (Lamport)", 0, NULL, NULL, 0 },
+#ifdef HAVE_C11_ATOMICS
+  { sum_peterson_fenced, "peterson_fenced", "Peterson's Algorithm (fenced)", 2, NULL, NULL, 0 },
+  { sum_dekker_fenced, "dekker_fenced", "Dekker's Algorithm (fenced)", 2, NULL, NULL, 0 },
+  { sum_bakery_fenced, "bakery_fenced", "Bakery Algorithm (Lamport, fenced)", 0, NULL, NULL, 0 },
+  { sum_filter, "filter", "filter lock", 0, NULL, NULL, 0 },
+  { sum_tournament, "tournament", "Peterson tournament tree", 0, NULL, NULL, 0 },
+#endif
+  { sum_test_and_set, "test_and_set", "test&set", 0, NULL, NULL, 1 },
+  { sum_ttas, "ttas", "test&test&set with backoff", 0, NULL, NULL, 1 },
+  { sum_ticket, "ticket", "ticket lock", 0, NULL, NULL, 1 },
+  { sum_mcs, "mcs", "MCS queue lock", 0, NULL, NULL, 1 },
+  { sum_clh, "clh", "CLH queue lock", 0, NULL, NULL, 0 },
+  { sum_semaphore, "semaphore", "semaphore", 0, NULL, NULL, 1 },
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  { sum_futex, "futex", "futex mutex", 0, report_futex, NULL, 1 },
+#endif
+  { sum_adaptive, "adaptive", "adaptive spin-then-park lock", 0, report_adaptive, NULL, 1 },
+  { sum_cohort, "cohort", "NUMA-aware cohort lock", 0, report_cohort, NULL, 0 },
+  { sum_combining, "combining", "flat combining", 0, report_combining, NULL, 0 },
+  { sum_delegation, "delegation", "delegation to a server thread", 0, report_delegation, NULL, 0 },
+  { sum_delegation_async, "delegation_async", "asynchronous delegation", 0, report_delegation, NULL, 0 },
+  { sum_atomic, "atomic", "atomic fetch_and_add", 0, NULL, NULL, 0 },
+  { sum_sharded, "sharded", "sharded counter", 0, NULL, collect_sharded, 0 },
+  { sum_local, "local", "thread-local reduction", 0, NULL, NULL, 0 },
+  { sum_rwlock, "rwlock", "reader-writer lock", 0, report_rw, NULL, 0 },
+  { sum_spin_rwlock, "spin_rwlock", "writer-preferring reader-writer spin-lock", 0, report_rw, NULL, 0 },
+  { sum_brlock, "brlock", "big reader lock", 0, report_rw, NULL, 0 },
+  { sum_seqlock, "seqlock", "sequence lock", 0, report_rw, NULL, 0 },
+  { sum_custom, "custom", "custom", 2, NULL, NULL, 0 },
+};
+
+#define NGUARDS (sizeof(guards) / sizeof(guards[0]))
+
+// the code below chooses the default guard type from the table above by
+// checking the preprocessor macros passed in the GNUMakefile. If none of the
+// macros is given, a guard type has to be selected on the command line.
+#if defined(HAVE_UNGUARDED)
+#  define DEFAULT_GUARD "unguarded"
+#elif defined(HAVE_TURNS)
+#  define DEFAULT_GUARD "turns"
 #elif defined(HAVE_FLAGS)
-  { sum_flags, "raise flags", 2 };
+#  define DEFAULT_GUARD "flags"
 #elif defined(HAVE_PETERSON)
-  { sum_peterson, "Peterson's Algorithm", 2 };
+#  define DEFAULT_GUARD "peterson"
 #elif defined(HAVE_DEKKER)
-  { sum_dekker, "Dekker's Algorithm", 2 };
+#  define DEFAULT_GUARD "dekker"
 #elif defined(HAVE_BAKERY)
-  { sum_bakery, "Bakery Algorithm (Lamport)", 0 };
+#  define DEFAULT_GUARD "bakery"
+#elif defined(HAVE_PETERSON_FENCED)
+#  define DEFAULT_GUARD "peterson_fenced"
+#elif defined(HAVE_DEKKER_FENCED)
+#  define DEFAULT_GUARD "dekker_fenced"
+#elif defined(HAVE_BAKERY_FENCED)
+#  define DEFAULT_GUARD "bakery_fenced"
+#elif defined(HAVE_FILTER)
+#  define DEFAULT_GUARD "filter"
+#elif defined(HAVE_TOURNAMENT)
+#  define DEFAULT_GUARD "tournament"
 #elif defined(HAVE_TEST_AND_SET)
-  { sum_test_and_set, "test&set", 0 };
+#  define DEFAULT_GUARD "test_and_set"
+#elif defined(HAVE_TTAS)
+#  define DEFAULT_GUARD "ttas"
+#elif defined(HAVE_TICKET)
+#  define DEFAULT_GUARD "ticket"
+#elif defined(HAVE_MCS)
+#  define DEFAULT_GUARD "mcs"
+#elif defined(HAVE_CLH)
+#  define DEFAULT_GUARD "clh"
 #elif defined(HAVE_SEMAPHORE)
-  { sum_semaphore, "semaphore", 0 };
+#  define DEFAULT_GUARD "semaphore"
+#elif defined(HAVE_FUTEX)
+#  define DEFAULT_GUARD "futex"
+#elif defined(HAVE_ADAPTIVE)
+#  define DEFAULT_GUARD "adaptive"
+#elif defined(HAVE_COHORT)
+#  define DEFAULT_GUARD "cohort"
+#elif defined(HAVE_COMBINING)
+#  define DEFAULT_GUARD "combining"
+#elif defined(HAVE_DELEGATION)
+#  define DEFAULT_GUARD "delegation"
+#elif defined(HAVE_DELEGATION_ASYNC)
+#  define DEFAULT_GUARD "delegation_async"
+#elif defined(HAVE_ATOMIC)
+#  define DEFAULT_GUARD "atomic"
+#elif defined(HAVE_SHARDED)
+#  define DEFAULT_GUARD "sharded"
+#elif defined(HAVE_LOCAL)
+#  define DEFAULT_GUARD "local"
+#elif defined(HAVE_RWLOCK)
+#  define DEFAULT_GUARD "rwlock"
+#elif defined(HAVE_SPIN_RWLOCK)
+#  define DEFAULT_GUARD "spin_rwlock"
+#elif defined(HAVE_BRLOCK)
+#  define DEFAULT_GUARD "brlock"
+#elif defined(HAVE_SEQLOCK)
+#  define DEFAULT_GUARD "seqlock"
 #elif defined(HAVE_CUSTOM)
-  { sum_custom, "custom", 2 };
+#  define DEFAULT_GUARD "custom"
 #endif
 
-// this is the main function. Program execution begins here.
-int
-main (void)
+// this function looks up a guard type in the table above by its key, and
+// returns its index, or -1 if no guard type with the given key exists.
+static int
+find_guard (const char *key, size_t len)
 {
-  // prepare an array of thread objects, and an array of thread arguments
-  thread_helper_t threads[THREADS] = { 0 };
-  int args[THREADS] = { 0 };
+  size_t i;
+  for (i = 0; i < NGUARDS; ++i)
+    if (strlen(guards[i].key) == len && strncmp(guards[i].key, key, len) == 0)
+      return i;
+  return -1;
+}
 
-  // initialize the shared mutex for the corresponding thread functions above
-  thread_helper_mutex_init(&mutex);
+// the placement of the threads of an experiment on the CPUs of the system. By
+// default, the threads are not pinned, and the operating system is free to
+// move them between the CPUs. Otherwise, thread i is pinned to the i-th CPU
+// of the placement order, wrapping around if there are more threads than
+// CPUs. The placement can be chosen with the --placement option:
+//
+//   compact - fill the hyper-threads of one core first, then the other cores
+//   of the same package, then the next package. Threads share as many caches
+//   as possible.
+//
+//   scatter - spread the threads across the packages first, then across the
+//   cores of each package, and use hyper-threads last. Threads share as few
+//   caches as possible.
+//
+//   a list of CPUs, e.g. 0,2,4-7 - use exactly the given CPUs in this order.
+#define MAX_CPUS 1024
+
+enum placement_t { PLACEMENT_NONE, PLACEMENT_COMPACT, PLACEMENT_SCATTER, PLACEMENT_LIST };
+
+static enum placement_t placement = PLACEMENT_NONE;
+static thread_helper_cpu_t topology[MAX_CPUS];
+static int ntopology = 0;
+static size_t placement_order[MAX_CPUS];
+static size_t nplacement = 0;
+
+// the topology of the CPUs, together with the rank of each CPU among the
+// hyper-threads of its core, and the rank of its core among the cores of its
+// package, used to sort the CPUs for the placements above
+struct placement_cpu_t
+{
+  thread_helper_cpu_t cpu;
+  int sibling;
+  int core_rank;
+};
+
+static int
+compare_compact (const void *a, const void *b)
+{
+  const thread_helper_cpu_t *x = &((const struct placement_cpu_t*)a)->cpu;
+  const thread_helper_cpu_t *y = &((const struct placement_cpu_t*)b)->cpu;
+  if (x->package != y->package)
+    return x->package - y->package;
+  if (x->core != y->core)
+    return x->core - y->core;
+  return x->cpu - y->cpu;
+}
+
+static int
+compare_scatter (const void *a, const void *b)
+{
+  const struct placement_cpu_t *x = a, *y = b;
+  if (x->sibling != y->sibling)
+    return x->sibling - y->sibling;
+  if (x->core_rank != y->core_rank)
+    return x->core_rank - y->core_rank;
+  return compare_compact(a, b);
+}
+
+// this function computes the placement order of the compact and scatter
+// placements from the topology of the system.
+static void
+compute_placement (void)
+{
+  static struct placement_cpu_t cpus[MAX_CPUS];
+
+  int i, n = ntopology;
+  for (i = 0; i < n; ++i)
+    cpus[i].cpu = topology[i];
+
+  // in compact order, the hyper-threads of a core and the cores of a package
+  // are next to each other, which makes it easy to rank them
+  qsort(cpus, n, sizeof(*cpus), compare_compact);
+  for (i = 0; i < n; ++i)
+    {
+      if (i > 0 && cpus[i].cpu.package == cpus[i - 1].cpu.package && cpus[i].cpu.core == cpus[i - 1].cpu.core)
+        {
+          cpus[i].sibling = cpus[i - 1].sibling + 1;
+          cpus[i].core_rank = cpus[i - 1].core_rank;
+        }
+      else
+        {
+          cpus[i].sibling = 0;
+          cpus[i].core_rank = (i > 0 && cpus[i].cpu.package == cpus[i - 1].cpu.package) ? cpus[i - 1].core_rank + 1 : 0;
+        }
+    }
+
+  if (placement == PLACEMENT_SCATTER)
+    qsort(cpus, n, sizeof(*cpus), compare_scatter);
+
+  for (i = 0; i < n; ++i)
+    placement_order[i] = cpus[i].cpu.cpu;
+  nplacement = n;
+}
+
+// this function returns the CPU to pin the thread with the given id to, or -1
+// if the thread is not pinned.
+static int
+placement_cpu (size_t id)
+{
+  if (placement == PLACEMENT_NONE || nplacement == 0)
+    return -1;
+  return placement_order[id % nplacement];
+}
+
+// this function returns the NUMA node of the thread with the given id, and is
+// called by that thread itself. Threads that are not pinned report the node of
+// the CPU they currently run on, which is only a snapshot, as the operating
+// system may move them to another node later on.
+static int
+placement_node (size_t id)
+{
+  int i, cpu = placement_cpu(id);
+  if (ntopology == 0)
+    return 0;
+  if (cpu < 0)
+    cpu = thread_helper_current_cpu();
+  for (i = 0; i < ntopology; ++i)
+    if (topology[i].cpu == cpu)
+      return topology[i].node;
+  return 0;
+}
+
+// the output format of the experiments. By default, the results of every
+// single run are printed in a human readable form. With the --format option,
+// every configuration of guard type, number of threads and layout is instead
+// summarized in one machine readable row, either as comma separated values
+// with a header line, or as one JSON object per line.
+enum format_t { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON };
+
+static enum format_t format = FORMAT_TEXT;
+
+// the number of times each configuration is run, after running it the given
+// number of times to warm up the caches and the CPU frequency, without
+// recording the results. The numbers can be changed with the --repeat and
+// --warmup options.
+#define MAX_REPEAT 1000
+
+static size_t repeat = 1;
+static size_t warmup = 0;
+// the placement as given on the command line. It is either one of the names of
+// the placements, or a list of CPUs that has been checked by parse_list, so it
+// only consists of digits, commas and hyphens. It never needs to be escaped in
+// json, but its commas require quotes in csv.
+static const char *placement_name = "none";
+
+// the barrier used to start all threads of an experiment at the same time.
+// Without it, the first threads would make a lot of progress before the last
+// threads are even created, and there would be much less contention.
+static thread_helper_barrier_t start_barrier;
+
+// the arguments passed to each thread of an experiment. The thread function
+// below waits at the start barrier, then runs the guard type of the experiment
+// and measures the wall-clock time and CPU time of the thread while doing so.
+struct thread_args_t
+{
+  int id;
+  const struct guard_type_t *guard;
+  unsigned long long start_ns;
+  unsigned long long end_ns;
+  unsigned long long cpu_ns;
+  thread_helper_counters_t counters;
+  int have_counters;
+};
+
+static thread_helper_return_t
+run_thread (void *args)
+{
+  struct thread_args_t *thread_args = args;
+
+  // the counters are set up before the barrier, and only started after it, so
+  // that neither the setup nor the waiting at the barrier is counted
+  if (counters)
+    thread_args->have_counters = thread_helper_counters_open(&thread_args->counters) == 0;
+
+  // the node of the thread is looked up by the thread itself, so that threads
+  // which are not pinned report the node they actually start on
+  cohort_nodes[thread_args->id] = placement_node(thread_args->id);
+
+  thread_helper_barrier_wait(&start_barrier);
+
+  if (thread_args->have_counters)
+    thread_helper_counters_start(&thread_args->counters);
+  unsigned long long start = thread_helper_thread_cpu_time_ns();
+  thread_args->start_ns = thread_helper_time_ns();
+  thread_args->guard->func(&thread_args->id);
+  thread_args->end_ns = thread_helper_time_ns();
+  if (thread_args->have_counters)
+    thread_helper_counters_stop(&thread_args->counters);
+#ifdef HAVE_STATS
+  stats_first_done = 1;
+#endif
+  thread_args->cpu_ns = thread_helper_thread_cpu_time_ns() - start;
 
-  // limit the number of threads by the number of threads supported by the
-  // selected guard type
-  size_t nthreads = (guard.max_threads > 0 && guard.max_threads < THREADS) ? guard.max_threads : THREADS;
-  printf("starting experiment \"%s\" with %zu threads\n", guard.name, nthreads);
+  return 0;
+}
 
-  // create the threads. The threads will start executing immediately.
+// this function sums up the performance counters of all threads of an
+// experiment, and prints them per acquisition of the guard. The instructions
+// per cycle tell whether the CPUs are busy computing or stalled, e.g. waiting
+// for cache lines owned by other CPUs, which also show up as cache misses.
+static void
+report_counters (const struct thread_args_t *args, unsigned long long entries)
+{
+  unsigned long long cycles = 0, instructions = 0, cache_misses = 0, migrations = 0;
+  long voluntary = 0, involuntary = 0;
+  int hardware = 1;
   size_t i;
+
   for (i = 0; i < nthreads; ++i)
     {
-      args[i] = i;
-      if (thread_helper_create(threads + i, guard.func, args + i) != 0)
+      if (!args[i].have_counters)
         {
-          perror("thread_helper_create");
-          return 1;
+          printf("counters:       performance counters are not available\n");
+          return;
         }
+      hardware &= args[i].counters.hardware;
+      cycles += args[i].counters.cycles;
+      instructions += args[i].counters.instructions;
+      cache_misses += args[i].counters.cache_misses;
+      migrations += args[i].counters.migrations;
+      voluntary += args[i].counters.voluntary_switches;
+      involuntary += args[i].counters.involuntary_switches;
+    }
+
+  if (hardware)
+    {
+      printf("ipc:           %20.2f\n", cycles ? (double)instructions / cycles : 0.0);
+      printf("cycles:        %17.1f /acquisition\n", (double)cycles / entries);
+      printf("llc misses:    %17.3f /acquisition\n", (double)cache_misses / entries);
+    }
+  else
+    printf("counters:       hardware counters are not available\n");
+  printf("migrations:    %20llu\n", migrations);
+  printf("voluntary cs:  %17.3f /acquisition (%ld)\n", (double)voluntary / entries, voluntary);
+  printf("involuntary cs:%17.3f /acquisition (%ld)\n", (double)involuntary / entries, involuntary);
+}
+
+// this function runs a single experiment: it runs the given guard type on the
+// requested number of workers of the given pool, waits for them to finish, and
+// prints the result of the computation together with the time it took. The
+// wall-clock time is also stored in the given location.
+static int
+run_experiment (const struct guard_type_t *guard, thread_helper_pool_t *pool, size_t count, unsigned long long *wall_time)
+{
+  // prepare an array of thread arguments
+  struct thread_args_t args[MAX_THREADS];
+
+  nthreads = count;
+  reset_experiment();
+
+  if (format == FORMAT_TEXT)
+    printf("starting experiment \"%s\" with %zu threads%s\n", guard->name, nthreads,
+           slot_stride ? " (padded layout)" : "");
+  if (format == FORMAT_TEXT && placement_cpu(0) >= 0)
+    {
+      size_t c;
+      printf("cpus:         ");
+      for (c = 0; c < nthreads; ++c)
+        printf(" %d", placement_cpu(c));
+      printf("\n");
+    }
+
+  if (thread_helper_barrier_init(&start_barrier, nthreads) != 0)
+    {
+      perror("thread_helper_barrier_init");
+      return 1;
     }
 
-  // join the threads. This blocks until the threads have terminated.
+  // run the experiment on the workers of the pool, which have been created
+  // before. This blocks until all of them have finished their loop.
+  size_t i;
   for (i = 0; i < nthreads; ++i)
-    if (thread_helper_join(threads[i]) != 0)
-      {
-        perror("thread_helper_join");
-        return 1;
-      }
+    {
+      args[i].id = i;
+      args[i].guard = guard;
+      args[i].start_ns = args[i].end_ns = args[i].cpu_ns = 0;
+      args[i].have_counters = 0;
+    }
+  if (thread_helper_pool_run(pool, run_thread, args, sizeof(*args)) != 0)
+    {
+      perror("thread_helper_pool_run");
+      return 1;
+    }
+
+  thread_helper_barrier_destroy(&start_barrier);
+
+  // the wall-clock time is measured from the release of the start barrier,
+  // when the first thread starts running its loop, until the last thread has
+  // finished its loop.
+  unsigned long long start = args[0].start_ns, end = args[0].end_ns;
+  for (i = 1; i < nthreads; ++i)
+    {
+      if (args[i].start_ns < start)
+        start = args[i].start_ns;
+      if (args[i].end_ns > end)
+        end = args[i].end_ns;
+    }
+  unsigned long long wall_ns = end - start;
 
   // print the result.
   //
@@ -388,8 +2735,577 @@ main (void)
   //   types usually not add up to the expected value of n * (n-1) / 2. The
   //   actual result is unpredictable and appears random, even though it is not
   //   truly random.
-  printf("sum is:        %20llu\n", res);
-  printf("sum should be: %20llu\n", (SUM_TO * (SUM_TO + 1)) / 2);
+  if (guard->collect)
+    guard->collect();
+
+  experiment_ns = wall_ns;
+  *wall_time = wall_ns;
+
+  // in the machine readable formats, the main function only prints a summary
+  // of all runs of a configuration
+  if (format != FORMAT_TEXT)
+    return 0;
+
+  printf("sum is:        %20llu\n", *res);
+  printf("sum should be: %20llu\n", (sum_to * (sum_to + 1)) / 2);
+
+  // print the timing.
+  //
+  //   Every number from 0 to sum_to is added exactly once, so each experiment
+  //   enters the critical section sum_to + 1 times in total. Observe how the
+  //   CPU time of spin-locking guards exceeds the wall-clock time when the
+  //   threads run in parallel, because waiting threads keep their CPUs busy.
+  unsigned long long entries = sum_to + 1;
+  unsigned long long cpu_ns = 0;
+  for (i = 0; i < nthreads; ++i)
+    cpu_ns += args[i].cpu_ns;
+
+  printf("wall time:     %17.3f ms\n", wall_ns / 1e6);
+  printf("cpu time:      %17.3f ms (", cpu_ns / 1e6);
+  for (i = 0; i < nthreads; ++i)
+    printf("%s%.3f", i ? ", " : "", args[i].cpu_ns / 1e6);
+  printf(")\n");
+  printf("throughput:    %17.0f entries/s\n", wall_ns ? entries * 1e9 / wall_ns : 0.0);
+  printf("latency:       %17.1f ns/acquisition\n", (double)wall_ns / entries);
+#ifdef HAVE_STATS
+  stats_report();
+#endif
+#ifdef HAVE_CHECK
+  printf("violations:    %20llu\n", check_violations);
+#endif
+  if (counters)
+    report_counters(args, entries);
+
+  if (try_mode)
+    report_try();
+  if (guard->report)
+    guard->report();
+
+  return 0;
+}
+
+static int
+compare_double (const void *a, const void *b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// this function runs the experiment of a guard type with the given number of
+// threads, first warmup times without recording the results, and then repeat
+// times. Unless there is only a single run, it prints the mean, median,
+// standard deviation and 95% confidence interval of the throughput over all
+// recorded runs, and whether all of them computed the correct sum. The median
+// wall-clock time is stored in the given location. In the padded layout, the
+// median wall-clock time of the packed layout is given as well, if it was run,
+// so that the machine readable formats can report the speedup. The medians
+// keep a single preempted run from dominating the speedup.
+static int
+run_repeated (const struct guard_type_t *guard, size_t count, unsigned long long packed_ns, unsigned long long *wall_time)
+{
+  // the 0.975 quantiles of Student's t-distribution for 1 to 30 degrees of
+  // freedom, beyond which the normal distribution is used
+  static const double t_quantiles[] =
+  {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  static double throughput[MAX_REPEAT];
+  static double wall[MAX_REPEAT];
+
+  unsigned long long entries = sum_to + 1, wall_ns;
+  int correct = 1;
+  size_t r;
+#ifdef HAVE_CHECK
+  size_t violating = 0;
+#endif
+
+  // create the threads once for all runs. The threads wait in the pool until
+  // the next run, so that short runs are not dominated by creating and joining
+  // the threads.
+  static thread_helper_pool_worker_t workers[MAX_THREADS];
+  int cpus[MAX_THREADS];
+  thread_helper_pool_t pool;
+  for (r = 0; r < count; ++r)
+    cpus[r] = placement_cpu(r);
+  if (thread_helper_pool_init(&pool, workers, count, cpus) != 0)
+    {
+      fprintf(stderr, "cannot create %zu threads\n", count);
+      return 1;
+    }
+
+  for (r = 0; r < warmup + repeat; ++r)
+    {
+      if (run_experiment(guard, &pool, count, &wall_ns) != 0)
+        {
+          // release the workers waiting in the pool before giving up
+          thread_helper_pool_destroy(&pool);
+          return 1;
+        }
+      if (r < warmup)
+        continue;
+      throughput[r - warmup] = wall_ns ? entries * 1e9 / wall_ns : 0.0;
+      wall[r - warmup] = wall_ns;
+      correct &= *res == (sum_to * (sum_to + 1)) / 2;
+#ifdef HAVE_CHECK
+      violating += check_violations != 0;
+      correct &= check_violations == 0;
+#endif
+    }
+  if (thread_helper_pool_destroy(&pool) != 0)
+    {
+      perror("thread_helper_pool_destroy");
+      return 1;
+    }
+  qsort(wall, repeat, sizeof(*wall), compare_double);
+  *wall_time = repeat % 2 ? wall[repeat / 2] : (wall[repeat / 2 - 1] + wall[repeat / 2]) / 2;
+
+  double mean = 0.0, variance = 0.0;
+  for (r = 0; r < repeat; ++r)
+    mean += throughput[r] / repeat;
+  for (r = 0; r < repeat; ++r)
+    variance += (throughput[r] - mean) * (throughput[r] - mean) / (repeat > 1 ? repeat - 1 : 1);
+
+  double stddev = sqrt(variance);
+  double ci = 0.0;
+  if (repeat > 1)
+    ci = (repeat - 1 <= 30 ? t_quantiles[repeat - 2] : 1.960) * stddev / sqrt((double)repeat);
+
+  qsort(throughput, repeat, sizeof(*throughput), compare_double);
+  double median = repeat % 2 ? throughput[repeat / 2] : (throughput[repeat / 2 - 1] + throughput[repeat / 2]) / 2;
+
+  char speedup[32] = "";
+  if (slot_stride && packed_ns && *wall_time)
+    snprintf(speedup, sizeof(speedup), "%.2f", (double)packed_ns / *wall_time);
+
+  switch (format)
+    {
+    case FORMAT_TEXT:
+      if (repeat == 1)
+        break;
+      printf("summary of \"%s\" with %zu threads over %zu runs:\n", guard->name, count, repeat);
+      printf("correct:       %20s\n", correct ? "yes" : "no");
+#ifdef HAVE_CHECK
+      printf("violating runs:%20zu\n", violating);
+#endif
+      printf("mean:          %17.0f entries/s\n", mean);
+      printf("median:        %17.0f entries/s\n", median);
+      printf("stddev:        %17.0f entries/s\n", stddev);
+      printf("95%% ci:        %17.0f entries/s\n", ci);
+      printf("min:           %17.0f entries/s\n", throughput[0]);
+      printf("max:           %17.0f entries/s\n", throughput[repeat - 1]);
+      break;
+    case FORMAT_CSV:
+      printf("%s,%zu,%llu,\"%s\",%s,%lu,%lu,%lu,%zu,%d,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%s\n",
+             guard->key, count, sum_to, placement_name, slot_stride ? "padded" : "packed",
+             work_cs_lines, work_ncs, write_ratio, repeat, correct,
+             mean, median, stddev, ci, throughput[0], throughput[repeat - 1], speedup);
+      break;
+    case FORMAT_JSON:
+      printf("{\"guard\": \"%s\", \"threads\": %zu, \"iterations\": %llu, \"placement\": \"%s\", "
+             "\"layout\": \"%s\", \"cs_lines\": %lu, \"ncs_work\": %lu, \"write_ratio\": %lu, "
+             "\"runs\": %zu, \"correct\": %s, \"mean\": %.0f, \"median\": %.0f, "
+             "\"stddev\": %.0f, \"ci95\": %.0f, \"min\": %.0f, \"max\": %.0f, \"speedup\": %s}\n",
+             guard->key, count, sum_to, placement_name, slot_stride ? "padded" : "packed",
+             work_cs_lines, work_ncs, write_ratio, repeat, correct ? "true" : "false",
+             mean, median, stddev, ci, throughput[0], throughput[repeat - 1], *speedup ? speedup : "null");
+      break;
+    }
+  fflush(stdout);
+
+  return 0;
+}
+
+// this function prints a short description of the command line options and
+// the available guard types.
+static void
+usage (const char *prog)
+{
+  size_t i;
+  printf("usage: %s [options]\n\n", prog);
+  printf("options:\n");
+  printf("  --guard LIST       comma separated list of guard types to run\n");
+  printf("  --all              run all guard types\n");
+  printf("  --exclude LIST     comma separated list of guard types not to run\n");
+  printf("  --threads LIST     comma separated list of thread counts or ranges,\n");
+  printf("                     e.g. 1-4,8,16 (default: %d, at most %d)\n", THREADS, MAX_THREADS);
+  printf("  --iterations N     limit of the sum to calculate (default: %llu)\n", SUM_TO);
+  printf("  --layout LAYOUT    layout of the shared state: packed, padded or both,\n");
+  printf("                     affects the shared variable and the state of the\n");
+  printf("                     guards turns to ticket in the list below\n");
+  printf("  --placement P      pin threads: none, compact, scatter or a list of CPUs\n");
+  printf("  --backoff-min N    initial bound of the backoff (default: %d)\n", BACKOFF_MIN);
+  printf("  --backoff-max N    maximum bound of the backoff (default: %d)\n", BACKOFF_MAX);
+  printf("  --cs-lines N       shared cache lines updated per critical section\n");
+  printf("  --ncs-work N       local work between two critical sections\n");
+  printf("  --work-distribution D\n");
+  printf("                     distribution of the work: fixed or uniform\n");
+  printf("  --write-ratio P    percentage of writes of the reader-writer guards\n");
+  printf("                     (default: %d)\n", WRITE_RATIO);
+  printf("  --repeat K         run every experiment K times (default: 1)\n");
+  printf("  --warmup W         run every experiment W times before (default: 0)\n");
+  printf("  --format F         output format: text, csv or json (default: text)\n");
+  printf("  --counters         collect performance counters of every thread\n");
+  printf("  --cohort-bound N   local handoffs of the cohort lock (default: %d)\n", COHORT_BOUND);
+  printf("  --try-timeout NS   give up acquiring the lock after NS nanoseconds\n");
+  printf("  --try-work N       local work after a failed attempt (default: %d)\n", TRY_WORK);
+#ifdef HAVE_CHECK
+  printf("  --jitter N         random delay around critical sections (default: 0)\n");
+#endif
+  printf("  --help             print this help and exit\n\n");
+  printf("guard types:\n");
+  for (i = 0; i < NGUARDS; ++i)
+    printf("  %-18s %s\n", guards[i].key, guards[i].name);
+}
+
+// this function parses a comma separated list of guard keys into an array of
+// indices into the guard table. It returns the number of parsed entries, or 0
+// on error.
+static size_t
+parse_guards (const char *arg, size_t *selected)
+{
+  size_t n = 0;
+  while (*arg)
+    {
+      size_t len = strcspn(arg, ",");
+      int idx = find_guard(arg, len);
+      if (idx < 0)
+        {
+          fprintf(stderr, "unknown guard type: %.*s\n", (int)len, arg);
+          return 0;
+        }
+      if (n == NGUARDS)
+        {
+          fprintf(stderr, "too many guard types\n");
+          return 0;
+        }
+      selected[n++] = idx;
+      arg += len;
+      if (*arg == ',')
+        ++arg;
+    }
+  return n;
+}
+
+// this function parses a comma separated list of numbers and ranges of numbers
+// between lo and hi into an array of at most max entries. It returns the
+// number of parsed entries, or 0 on error.
+static size_t
+parse_list (const char *arg, size_t *values, size_t max, unsigned long lo, unsigned long hi, const char *what)
+{
+  size_t n = 0;
+  while (*arg)
+    {
+      char *end;
+      unsigned long from = strtoul(arg, &end, 10);
+      unsigned long to = from;
+      if (*end == '-')
+        to = strtoul(end + 1, &end, 10);
+      if (end == arg || (*end != ',' && *end != '\0') || from < lo || to < from || to > hi)
+        {
+          fprintf(stderr, "invalid %s: %s\n", what, arg);
+          return 0;
+        }
+      for (; from <= to && n < max; ++from)
+        values[n++] = from;
+      arg = (*end == ',') ? end + 1 : end;
+    }
+  return n;
+}
+
+// the layouts of the shared area selected on the command line
+#define LAYOUT_PACKED 1
+#define LAYOUT_PADDED 2
+
+// this is the main function. Program execution begins here.
+int
+main (int argc, char *argv[])
+{
+  size_t selected[NGUARDS];
+  size_t nselected = 0;
+  size_t excluded[NGUARDS];
+  size_t nexcluded = 0;
+  size_t counts[MAX_THREADS] = { THREADS };
+  size_t ncounts = 1;
+  int layouts = LAYOUT_PACKED;
+
+#ifdef DEFAULT_GUARD
+  if (find_guard(DEFAULT_GUARD, strlen(DEFAULT_GUARD)) >= 0)
+    selected[nselected++] = find_guard(DEFAULT_GUARD, strlen(DEFAULT_GUARD));
+#endif
+
+  // parse the command line options
+  int i;
+  for (i = 1; i < argc; ++i)
+    {
+      if (strcmp(argv[i], "--all") == 0)
+        {
+          for (nselected = 0; nselected < NGUARDS; ++nselected)
+            selected[nselected] = nselected;
+        }
+      else if (strcmp(argv[i], "--exclude") == 0 && i + 1 < argc)
+        {
+          if (!(nexcluded = parse_guards(argv[++i], excluded)))
+            return 1;
+        }
+      else if (strcmp(argv[i], "--guard") == 0 && i + 1 < argc)
+        {
+          if (!(nselected = parse_guards(argv[++i], selected)))
+            return 1;
+        }
+      else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+          if (!(ncounts = parse_list(argv[++i], counts, MAX_THREADS, 1, MAX_THREADS, "thread count")))
+            return 1;
+        }
+      else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+          char *end;
+          sum_to = strtoull(argv[++i], &end, 10);
+          if (*end != '\0' || sum_to == 0)
+            {
+              fprintf(stderr, "invalid number of iterations: %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if ((strcmp(argv[i], "--backoff-min") == 0 || strcmp(argv[i], "--backoff-max") == 0) && i + 1 < argc)
+        {
+          char *end;
+          unsigned long value = strtoul(argv[i + 1], &end, 10);
+          if (*end != '\0' || value == 0)
+            {
+              fprintf(stderr, "invalid backoff bound: %s\n", argv[i + 1]);
+              return 1;
+            }
+          *(strcmp(argv[i], "--backoff-min") == 0 ? &backoff_min : &backoff_max) = value;
+          ++i;
+        }
+      else if ((strcmp(argv[i], "--cs-lines") == 0 || strcmp(argv[i], "--ncs-work") == 0) && i + 1 < argc)
+        {
+          char *end;
+          unsigned long value = strtoul(argv[i + 1], &end, 10);
+          if (*end != '\0' || end == argv[i + 1] || (strcmp(argv[i], "--cs-lines") == 0 && value > WORK_MAX_LINES))
+            {
+              fprintf(stderr, "invalid amount of work: %s\n", argv[i + 1]);
+              return 1;
+            }
+          *(strcmp(argv[i], "--cs-lines") == 0 ? &work_cs_lines : &work_ncs) = value;
+          ++i;
+        }
+      else if (strcmp(argv[i], "--work-distribution") == 0 && i + 1 < argc)
+        {
+          ++i;
+          if (strcmp(argv[i], "fixed") == 0)
+            work_distribution = WORK_FIXED;
+          else if (strcmp(argv[i], "uniform") == 0)
+            work_distribution = WORK_UNIFORM;
+          else
+            {
+              fprintf(stderr, "invalid work distribution: %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if (strcmp(argv[i], "--write-ratio") == 0 && i + 1 < argc)
+        {
+          char *end;
+          write_ratio = strtoul(argv[++i], &end, 10);
+          if (*end != '\0' || end == argv[i] || write_ratio > 100)
+            {
+              fprintf(stderr, "invalid write ratio: %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if ((strcmp(argv[i], "--repeat") == 0 || strcmp(argv[i], "--warmup") == 0) && i + 1 < argc)
+        {
+          char *end;
+          unsigned long value = strtoul(argv[i + 1], &end, 10);
+          if (*end != '\0' || end == argv[i + 1] || value > MAX_REPEAT || (value == 0 && strcmp(argv[i], "--repeat") == 0))
+            {
+              fprintf(stderr, "invalid number of runs: %s\n", argv[i + 1]);
+              return 1;
+            }
+          *(strcmp(argv[i], "--repeat") == 0 ? &repeat : &warmup) = value;
+          ++i;
+        }
+      else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+          ++i;
+          if (strcmp(argv[i], "text") == 0)
+            format = FORMAT_TEXT;
+          else if (strcmp(argv[i], "csv") == 0)
+            format = FORMAT_CSV;
+          else if (strcmp(argv[i], "json") == 0)
+            format = FORMAT_JSON;
+          else
+            {
+              fprintf(stderr, "invalid format: %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if ((strcmp(argv[i], "--try-timeout") == 0 || strcmp(argv[i], "--try-work") == 0) && i + 1 < argc)
+        {
+          char *end;
+          unsigned long long value = strtoull(argv[i + 1], &end, 10);
+          if (*end != '\0' || end == argv[i + 1])
+            {
+              fprintf(stderr, "invalid %s: %s\n", argv[i] + 2, argv[i + 1]);
+              return 1;
+            }
+          if (strcmp(argv[i], "--try-timeout") == 0)
+            {
+              try_mode = 1;
+              try_timeout = value;
+            }
+          else
+            try_work = value;
+          ++i;
+        }
+      else if (strcmp(argv[i], "--counters") == 0)
+        counters = 1;
+      else if (strcmp(argv[i], "--cohort-bound") == 0 && i + 1 < argc)
+        {
+          char *end;
+          cohort_bound = strtoul(argv[++i], &end, 10);
+          if (*end != '\0' || end == argv[i])
+            {
+              fprintf(stderr, "invalid cohort bound: %s\n", argv[i]);
+              return 1;
+            }
+        }
+#ifdef HAVE_CHECK
+      else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+        {
+          char *end;
+          check_jitter = strtoul(argv[++i], &end, 10);
+          if (*end != '\0' || end == argv[i])
+            {
+              fprintf(stderr, "invalid jitter: %s\n", argv[i]);
+              return 1;
+            }
+        }
+#endif
+      else if (strcmp(argv[i], "--placement") == 0 && i + 1 < argc)
+        {
+          ++i;
+          placement_name = argv[i];
+          if (strcmp(argv[i], "none") == 0)
+            placement = PLACEMENT_NONE;
+          else if (strcmp(argv[i], "compact") == 0)
+            placement = PLACEMENT_COMPACT;
+          else if (strcmp(argv[i], "scatter") == 0)
+            placement = PLACEMENT_SCATTER;
+          else if ((nplacement = parse_list(argv[i], placement_order, MAX_CPUS, 0, MAX_CPUS - 1, "placement")) > 0)
+            placement = PLACEMENT_LIST;
+          else
+            return 1;
+        }
+      else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc)
+        {
+          ++i;
+          if (strcmp(argv[i], "packed") == 0)
+            layouts = LAYOUT_PACKED;
+          else if (strcmp(argv[i], "padded") == 0)
+            layouts = LAYOUT_PADDED;
+          else if (strcmp(argv[i], "both") == 0)
+            layouts = LAYOUT_PACKED | LAYOUT_PADDED;
+          else
+            {
+              fprintf(stderr, "invalid layout: %s\n", argv[i]);
+              return 1;
+            }
+        }
+      else if (strcmp(argv[i], "--help") == 0)
+        {
+          usage(argv[0]);
+          return 0;
+        }
+      else
+        {
+          usage(argv[0]);
+          return 1;
+        }
+    }
+
+  if (backoff_min > backoff_max)
+    {
+      fprintf(stderr, "invalid backoff bounds: %lu exceeds %lu\n", backoff_min, backoff_max);
+      return 1;
+    }
+
+  // remove the excluded guard types from the selection, e.g. the ones that
+  // are broken on purpose, which would spoil an unattended run of --all
+  size_t g, c, e;
+  for (g = c = 0; g < nselected; ++g)
+    {
+      for (e = 0; e < nexcluded && excluded[e] != selected[g]; ++e);
+      if (e == nexcluded)
+        selected[c++] = selected[g];
+    }
+  nselected = c;
+
+  if (nselected == 0)
+    {
+      fprintf(stderr, "no guard type selected, use --guard or --all\n");
+      return 1;
+    }
+
+  // the other guards have no try-lock, and would silently block instead
+  for (g = 0; g < nselected; ++g)
+    if (try_mode && !guards[selected[g]].try_lock)
+      {
+        fprintf(stderr, "guard type does not support --try-timeout: %s\n", guards[selected[g]].key);
+        return 1;
+      }
+
+  ntopology = thread_helper_topology(topology, MAX_CPUS);
+  if (placement == PLACEMENT_COMPACT || placement == PLACEMENT_SCATTER)
+    compute_placement();
+
+  // initialize the shared mutex and lock for the corresponding thread
+  // functions above
+  thread_helper_mutex_init(&mutex);
+  thread_helper_rwlock_init(&rwlock);
+  thread_helper_adaptive_init(&adaptive_lock);
+
+  if (format == FORMAT_CSV)
+    printf("guard,threads,iterations,placement,layout,cs_lines,ncs_work,write_ratio,"
+           "runs,correct,mean,median,stddev,ci95,min,max,speedup\n");
+
+  // run the experiments for all selected guard types and thread counts
+  for (g = 0; g < nselected; ++g)
+    {
+      const struct guard_type_t *guard = guards + selected[g];
+      size_t last = 0;
+      for (c = 0; c < ncounts; ++c)
+        {
+          // limit the number of threads by the number of threads supported
+          // by the selected guard type, and skip thread counts that would
+          // repeat the previous experiment after this fallback.
+          size_t count = (guard->max_threads > 0 && guard->max_threads < counts[c]) ? guard->max_threads : counts[c];
+          if (count == last)
+            continue;
+          last = count;
+
+          // run the experiment in each of the selected layouts, and compare
+          // the throughput if both layouts were selected
+          unsigned long long packed_ns = 0, padded_ns = 0;
+          if (layouts & LAYOUT_PACKED)
+            {
+              slot_stride = 0;
+              if (run_repeated(guard, count, 0, &packed_ns) != 0)
+                return 1;
+            }
+          if (layouts & LAYOUT_PADDED)
+            {
+              slot_stride = THREAD_HELPER_CACHE_LINE;
+              if (run_repeated(guard, count, packed_ns, &padded_ns) != 0)
+                return 1;
+            }
+          if (packed_ns && padded_ns && format == FORMAT_TEXT)
+            printf("padded speedup:%20.2fx\n", (double)packed_ns / padded_ns);
+        }
+    }
 
   return 0;
 }
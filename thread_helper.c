@@ -1,6 +1,36 @@
 
+// the affinity functions of Linux are GNU extensions
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "thread_helper.h"
 
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <stdlib.h>
+#endif
+
+#ifdef THREAD_HELPER_HAVE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef THREAD_HELPER_HAVE_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
 int
 thread_helper_create(thread_helper_t *thread, thread_helper_return_t(*thread_func)(void*), void *arg)
 {
@@ -16,6 +46,150 @@ thread_helper_create(thread_helper_t *thread, thread_helper_return_t(*thread_fun
 #endif
 }
 
+int
+thread_helper_create_on_cpu(thread_helper_t *thread, thread_helper_return_t(*thread_func)(void*), void *arg, int cpu)
+{
+  if (cpu < 0)
+    return thread_helper_create(thread, thread_func, arg) != 0;
+
+#if defined(_WIN32)
+  // Windows Implementation based on CreateThread, creating the thread
+  // suspended and resuming it after setting its affinity mask
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-setthreadaffinitymask
+  if (cpu >= 64)
+    return 1;
+  *thread = CreateThread(NULL, 0, thread_func, arg, CREATE_SUSPENDED, NULL);
+  if (*thread == NULL)
+    return 1;
+  if (SetThreadAffinityMask(*thread, (DWORD_PTR)1 << cpu) == 0)
+    {
+      TerminateThread(*thread, 1);
+      CloseHandle(*thread);
+      return 1;
+    }
+  ResumeThread(*thread);
+  return 0;
+#elif defined(__linux__)
+  // Linux Implementation based on pthread_attr_setaffinity_np, which pins the
+  // thread before it starts executing
+  //   see: https://man7.org/linux/man-pages/man3/pthread_attr_setaffinity_np.3.html
+  pthread_attr_t attr;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_attr_init(&attr) != 0)
+    return 1;
+  int res = pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+  if (res == 0)
+    res = pthread_create(thread, &attr, thread_func, arg);
+  pthread_attr_destroy(&attr);
+  return res != 0;
+#else
+  // other POSIX systems provide no means to pin threads
+  return thread_helper_create(thread, thread_func, arg) != 0;
+#endif
+}
+
+#ifdef __linux__
+// this helper function reads an integer from a file in the sysfs directory of
+// the given CPU, and returns the given default value if it does not exist.
+static int
+read_cpu_attribute(int cpu, const char *name, int value)
+{
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return value;
+  if (fscanf(f, "%d", &value) != 1)
+    value = -1;
+  fclose(f);
+  return value;
+}
+
+// this helper function finds the NUMA node of the given CPU, which is linked
+// as a nodeN entry in the sysfs directory of the CPU.
+static int
+read_cpu_node(int cpu)
+{
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+  DIR *dir = opendir(path);
+  if (dir == NULL)
+    return 0;
+  int node = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+    if (sscanf(entry->d_name, "node%d", &node) == 1)
+      break;
+  closedir(dir);
+  return node;
+}
+#endif
+
+int
+thread_helper_topology(thread_helper_cpu_t *cpus, int max)
+{
+  int n = 0;
+#if defined(__linux__)
+  // Linux Implementation based on sched_getaffinity and sysfs
+  //   see: https://man7.org/linux/man-pages/man2/sched_setaffinity.2.html
+  //   see: https://www.kernel.org/doc/html/latest/admin-guide/cputopology.html
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+      int cpu;
+      for (cpu = 0; cpu < CPU_SETSIZE && n < max; ++cpu)
+        {
+          if (!CPU_ISSET(cpu, &set))
+            continue;
+          cpus[n].cpu = cpu;
+          cpus[n].core = read_cpu_attribute(cpu, "topology/core_id", cpu);
+          cpus[n].package = read_cpu_attribute(cpu, "topology/physical_package_id", 0);
+          cpus[n].node = read_cpu_node(cpu);
+          ++n;
+        }
+      if (n > 0)
+        return n;
+    }
+#endif
+
+  // fallback for other systems, reporting every CPU as its own core
+  int count;
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  count = info.dwNumberOfProcessors;
+#else
+  count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  for (n = 0; n < count && n < max; ++n)
+    {
+      cpus[n].cpu = n;
+      cpus[n].core = n;
+      cpus[n].package = 0;
+      cpus[n].node = 0;
+    }
+  return n;
+}
+
+int
+thread_helper_current_cpu(void)
+{
+#if defined(__linux__)
+  // Linux Implementation based on sched_getcpu
+  //   see: https://man7.org/linux/man-pages/man3/sched_getcpu.3.html
+  return sched_getcpu();
+#elif defined(_WIN32)
+  // Windows Implementation based on GetCurrentProcessorNumber
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-getcurrentprocessornumber
+  return (int)GetCurrentProcessorNumber();
+#else
+  // other POSIX systems provide no means to find the current CPU
+  return -1;
+#endif
+}
+
 int
 thread_helper_join(thread_helper_t thread)
 {
@@ -32,49 +206,303 @@ thread_helper_join(thread_helper_t thread)
 #endif
 }
 
+#ifdef THREAD_HELPER_HAVE_FUTEX
+// these helper functions sleep on a futex as long as it holds the given value,
+// and wake up one thread sleeping on a futex
+//   see: https://man7.org/linux/man-pages/man2/futex.2.html
+static void
+futex_wait(volatile int *futex, int value, const struct timespec *timeout)
+{
+  syscall(SYS_futex, futex, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+}
+
+static void
+futex_wake(volatile int *futex)
+{
+  syscall(SYS_futex, futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// these helper functions implement the three-state futex mutex described by
+// Ulrich Drepper in "Futexes Are Tricky", on top of the futex system call
+static void
+futex_mutex_lock(thread_helper_mutex_t *mutex)
+{
+  // fast path: the mutex is unlocked, lock it without a system call
+  int c = __sync_val_compare_and_swap(&mutex->futex, 0, 1);
+  if (c == 0)
+    return;
+
+  // slow path: mark the mutex as contended, and sleep until it is unlocked.
+  // The kernel only puts the thread to sleep if the futex still holds 2, so a
+  // wake up between the exchange and the system call is never lost.
+  if (c != 2)
+    c = __atomic_exchange_n(&mutex->futex, 2, __ATOMIC_ACQUIRE);
+  while (c != 0)
+    {
+      __sync_fetch_and_add(&mutex->futex_waits, 1);
+      futex_wait(&mutex->futex, 2, NULL);
+      c = __atomic_exchange_n(&mutex->futex, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+// the same as futex_mutex_lock, but the thread only sleeps until the given
+// deadline. A thread that gives up leaves the mutex marked as contended, which
+// only costs the owner an unneeded wake up.
+static int
+futex_mutex_timedlock(thread_helper_mutex_t *mutex, unsigned long long deadline)
+{
+  int c = __sync_val_compare_and_swap(&mutex->futex, 0, 1);
+  if (c == 0)
+    return 0;
+
+  if (c != 2)
+    c = __atomic_exchange_n(&mutex->futex, 2, __ATOMIC_ACQUIRE);
+  while (c != 0)
+    {
+      unsigned long long now = thread_helper_time_ns();
+      if (now >= deadline)
+        return 1;
+      struct timespec timeout = { (deadline - now) / 1000000000ULL, (deadline - now) % 1000000000ULL };
+      __sync_fetch_and_add(&mutex->futex_waits, 1);
+      futex_wait(&mutex->futex, 2, &timeout);
+      c = __atomic_exchange_n(&mutex->futex, 2, __ATOMIC_ACQUIRE);
+    }
+  return 0;
+}
+
+static void
+futex_mutex_unlock(thread_helper_mutex_t *mutex)
+{
+  // fast path: the mutex was not contended, no thread needs to be woken up
+  if (__sync_fetch_and_sub(&mutex->futex, 1) == 1)
+    return;
+
+  // slow path: threads may be sleeping, unlock the mutex and wake up one
+  __atomic_store_n(&mutex->futex, 0, __ATOMIC_RELEASE);
+  __sync_fetch_and_add(&mutex->futex_wakes, 1);
+  futex_wake(&mutex->futex);
+}
+#endif
+
 int
 thread_helper_mutex_init(thread_helper_mutex_t *semaphore)
 {
+  return thread_helper_mutex_init_type(semaphore, THREAD_HELPER_MUTEX_NATIVE);
+}
+
+int
+thread_helper_mutex_init_type(thread_helper_mutex_t *semaphore, enum thread_helper_mutex_type_t type)
+{
+  semaphore->type = type;
+  semaphore->futex = 0;
+  semaphore->futex_waits = 0;
+  semaphore->futex_wakes = 0;
+
+  if (type == THREAD_HELPER_MUTEX_FUTEX)
+    {
+#ifdef THREAD_HELPER_HAVE_FUTEX
+      // Linux Implementation based on the futex system call, see above
+      return 0;
+#else
+      return 1;
+#endif
+    }
+
 #ifdef _WIN32
   // Windows Implementation based on InitializeCriticalSection
   //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-initializecriticalsection
-  InitializeCriticalSection(semaphore);
+  InitializeCriticalSection(&semaphore->native);
   return 0;
 #else
   // POSIX Implementation based on pthread_mutex_init
   //   see: https://man7.org/linux/man-pages/man3/pthread_mutex_destroy.3p.html
-  return pthread_mutex_init(semaphore, NULL);
+  return pthread_mutex_init(&semaphore->native, NULL);
 #endif
 }
 
 int
 thread_helper_mutex_lock(thread_helper_mutex_t *semaphore)
 {
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  if (semaphore->type == THREAD_HELPER_MUTEX_FUTEX)
+    {
+      futex_mutex_lock(semaphore);
+      return 0;
+    }
+#endif
+
 #ifdef _WIN32
   // Windows Implementation based on EnterCriticalSection
   //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-entercriticalsection
-  EnterCriticalSection(semaphore);
+  EnterCriticalSection(&semaphore->native);
   return 0;
 #else
   // POSIX Implementation based on pthread_mutex_lock
   //   see: https://man7.org/linux/man-pages/man3/pthread_mutex_lock.3p.html
-  return pthread_mutex_lock(semaphore);
+  return pthread_mutex_lock(&semaphore->native);
+#endif
+}
+
+int
+thread_helper_mutex_trylock(thread_helper_mutex_t *semaphore)
+{
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  if (semaphore->type == THREAD_HELPER_MUTEX_FUTEX)
+    return !__sync_bool_compare_and_swap(&semaphore->futex, 0, 1);
+#endif
+
+#ifdef _WIN32
+  // Windows Implementation based on TryEnterCriticalSection
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-tryentercriticalsection
+  return !TryEnterCriticalSection(&semaphore->native);
+#else
+  // POSIX Implementation based on pthread_mutex_trylock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_mutex_lock.3p.html
+  return pthread_mutex_trylock(&semaphore->native) != 0;
+#endif
+}
+
+int
+thread_helper_mutex_timedlock(thread_helper_mutex_t *semaphore, unsigned long long deadline)
+{
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  if (semaphore->type == THREAD_HELPER_MUTEX_FUTEX)
+    return futex_mutex_timedlock(semaphore, deadline);
+#endif
+
+#if !defined(_WIN32) && defined(_POSIX_TIMEOUTS) && _POSIX_TIMEOUTS > 0
+  // POSIX Implementation based on pthread_mutex_timedlock, which expects the
+  // deadline as an absolute time of the realtime clock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_mutex_timedlock.3p.html
+  unsigned long long now = thread_helper_time_ns();
+  struct timespec abstime;
+  clock_gettime(CLOCK_REALTIME, &abstime);
+  unsigned long long ns = abstime.tv_sec * 1000000000ULL + abstime.tv_nsec + (deadline > now ? deadline - now : 0);
+  abstime.tv_sec = ns / 1000000000ULL;
+  abstime.tv_nsec = ns % 1000000000ULL;
+  return pthread_mutex_timedlock(&semaphore->native, &abstime) != 0;
+#else
+  // Polling Implementation for systems without timed mutexes, such as Windows
+  // and MacOS, yielding the CPU to other threads in every iteration
+  while (thread_helper_mutex_trylock(semaphore) != 0)
+    {
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+#ifdef _WIN32
+      SwitchToThread();
+#else
+      sched_yield();
+#endif
+    }
+  return 0;
 #endif
 }
 
 int
 thread_helper_mutex_unlock(thread_helper_mutex_t *semaphore)
 {
+#ifdef THREAD_HELPER_HAVE_FUTEX
+  if (semaphore->type == THREAD_HELPER_MUTEX_FUTEX)
+    {
+      futex_mutex_unlock(semaphore);
+      return 0;
+    }
+#endif
+
 #ifdef _WIN32
 
   // Windows Implementation based on LeaveCriticalSection
   //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-leavecriticalsection
-  LeaveCriticalSection(semaphore);
+  LeaveCriticalSection(&semaphore->native);
   return 0;
 #else
   // POSIX Implementation based on pthread_mutex_unlock
   //   see: https://man7.org/linux/man-pages/man3/pthread_mutex_lock.3p.html
-  return pthread_mutex_unlock(semaphore);
+  return pthread_mutex_unlock(&semaphore->native);
+#endif
+}
+
+void
+thread_helper_mutex_syscalls(thread_helper_mutex_t *semaphore, long *waits, long *wakes)
+{
+  *waits = semaphore->futex_waits;
+  *wakes = semaphore->futex_wakes;
+  semaphore->futex_waits = 0;
+  semaphore->futex_wakes = 0;
+}
+
+int
+thread_helper_rwlock_init(thread_helper_rwlock_t *lock)
+{
+#ifdef _WIN32
+  // Windows Implementation based on InitializeSRWLock
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-initializesrwlock
+  InitializeSRWLock(lock);
+  return 0;
+#else
+  // POSIX Implementation based on pthread_rwlock_init
+  //   see: https://man7.org/linux/man-pages/man3/pthread_rwlock_init.3p.html
+  return pthread_rwlock_init(lock, NULL) != 0;
+#endif
+}
+
+int
+thread_helper_rwlock_read_lock(thread_helper_rwlock_t *lock)
+{
+#ifdef _WIN32
+  // Windows Implementation based on AcquireSRWLockShared
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-acquiresrwlockshared
+  AcquireSRWLockShared(lock);
+  return 0;
+#else
+  // POSIX Implementation based on pthread_rwlock_rdlock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_rwlock_rdlock.3p.html
+  return pthread_rwlock_rdlock(lock) != 0;
+#endif
+}
+
+int
+thread_helper_rwlock_read_unlock(thread_helper_rwlock_t *lock)
+{
+#ifdef _WIN32
+  // Windows Implementation based on ReleaseSRWLockShared
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-releasesrwlockshared
+  ReleaseSRWLockShared(lock);
+  return 0;
+#else
+  // POSIX Implementation based on pthread_rwlock_unlock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_rwlock_unlock.3p.html
+  return pthread_rwlock_unlock(lock) != 0;
+#endif
+}
+
+int
+thread_helper_rwlock_write_lock(thread_helper_rwlock_t *lock)
+{
+#ifdef _WIN32
+  // Windows Implementation based on AcquireSRWLockExclusive
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-acquiresrwlockexclusive
+  AcquireSRWLockExclusive(lock);
+  return 0;
+#else
+  // POSIX Implementation based on pthread_rwlock_wrlock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_rwlock_wrlock.3p.html
+  return pthread_rwlock_wrlock(lock) != 0;
+#endif
+}
+
+int
+thread_helper_rwlock_write_unlock(thread_helper_rwlock_t *lock)
+{
+#ifdef _WIN32
+  // Windows Implementation based on ReleaseSRWLockExclusive
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-releasesrwlockexclusive
+  ReleaseSRWLockExclusive(lock);
+  return 0;
+#else
+  // POSIX Implementation based on pthread_rwlock_unlock
+  //   see: https://man7.org/linux/man-pages/man3/pthread_rwlock_unlock.3p.html
+  return pthread_rwlock_unlock(lock) != 0;
 #endif
 }
 
@@ -92,6 +520,27 @@ thread_helper_test_and_set_lock(int *lock)
 #endif
 }
 
+int
+thread_helper_test_and_set_timedlock(int *lock, unsigned long long deadline)
+{
+  // spin on reading the lock, and only try to set it again once it has been
+  // released, see thread_helper_test_and_test_and_set_lock. The deadline is
+  // checked after every failed attempt, as the lock may already have been
+  // released again when it is read.
+  while (thread_helper_test_and_set_lock(lock))
+    {
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+      while (*(volatile int*)lock)
+        {
+          if (thread_helper_time_ns() >= deadline)
+            return 1;
+          thread_helper_cpu_relax();
+        }
+    }
+  return 0;
+}
+
 void
 thread_helper_test_and_set_unlock(int *lock)
 {
@@ -105,3 +554,1161 @@ thread_helper_test_and_set_unlock(int *lock)
   __sync_lock_release(lock);
 #endif
 }
+
+int
+thread_helper_load_acquire(volatile int *ptr)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation, where volatile loads have acquire semantics
+  //   see: https://docs.microsoft.com/en-us/cpp/build/reference/volatile-volatile-keyword-interpretation?view=msvc-160
+  return *ptr;
+#else
+  // gcc and clang Implementation based on __atomic_load_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void
+thread_helper_store_release(volatile int *ptr, int value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation, where volatile stores have release semantics
+  //   see: https://docs.microsoft.com/en-us/cpp/build/reference/volatile-volatile-keyword-interpretation?view=msvc-160
+  *ptr = value;
+#else
+  // gcc and clang Implementation based on __atomic_store_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+unsigned long long
+thread_helper_load_acquire_64(volatile unsigned long long *ptr)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedCompareExchange64 intrinsic,
+  // since plain 64 bit loads are not atomic on 32 bit x86
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedcompareexchange-intrinsic-functions?view=msvc-160
+  return _InterlockedCompareExchange64((volatile __int64*)ptr, 0, 0);
+#else
+  // gcc and clang Implementation based on __atomic_load_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void
+thread_helper_store_release_64(volatile unsigned long long *ptr, unsigned long long value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedExchange64 intrinsic, since
+  // plain 64 bit stores are not atomic on 32 bit x86
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedexchange-intrinsic-functions?view=msvc-160
+  _InterlockedExchange64((volatile __int64*)ptr, value);
+#else
+  // gcc and clang Implementation based on __atomic_store_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+unsigned long long
+thread_helper_fetch_and_add(volatile unsigned long long *ptr, unsigned long long value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedExchangeAdd64 intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedexchangeadd-intrinsic-functions?view=msvc-160
+  return _InterlockedExchangeAdd64((volatile __int64*)ptr, value);
+#else
+  // gcc and clang Implementation based on __sync_fetch_and_add intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return __sync_fetch_and_add(ptr, value);
+#endif
+}
+
+void
+thread_helper_cpu_relax(void)
+{
+#if defined(_MSC_VER)
+  // cl.exe Implementation based on the YieldProcessor macro
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-yieldprocessor
+  YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+  // gcc and clang Implementation based on the x86 pause instruction
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/x86-Built-in-Functions.html
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  // gcc and clang Implementation based on the ARM yield instruction
+  __asm__ __volatile__ ("yield" ::: "memory");
+#else
+  // fallback to a compiler barrier on other architectures
+  __asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
+void
+thread_helper_backoff_init(thread_helper_backoff_t *backoff, unsigned long min, unsigned long max, unsigned long seed)
+{
+  backoff->min = min > 0 ? min : 1;
+  backoff->max = max > backoff->min ? max : backoff->min;
+  backoff->limit = backoff->min;
+  backoff->seed = seed ? seed : 1;
+}
+
+void
+thread_helper_backoff(thread_helper_backoff_t *backoff)
+{
+  // draw a random number with a xorshift generator, which is cheap enough not
+  // to dominate short backoffs
+  unsigned long x = backoff->seed;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  backoff->seed = x;
+
+  unsigned long i, n = x % backoff->limit + 1;
+  for (i = 0; i < n; ++i)
+    thread_helper_cpu_relax();
+
+  if (backoff->limit < backoff->max)
+    backoff->limit = (backoff->limit * 2 < backoff->max) ? backoff->limit * 2 : backoff->max;
+}
+
+void
+thread_helper_test_and_test_and_set_lock(int *lock, thread_helper_backoff_t *backoff)
+{
+  backoff->limit = backoff->min;
+  for (;;)
+    {
+      while (*(volatile int*)lock)
+        thread_helper_cpu_relax();
+      if (!thread_helper_test_and_set_lock(lock))
+        return;
+      thread_helper_backoff(backoff);
+    }
+}
+
+int
+thread_helper_test_and_test_and_set_timedlock(int *lock, thread_helper_backoff_t *backoff, unsigned long long deadline)
+{
+  // like thread_helper_test_and_test_and_set_lock, but the deadline is checked
+  // while spinning on the read, and after every failed attempt
+  backoff->limit = backoff->min;
+  for (;;)
+    {
+      while (*(volatile int*)lock)
+        {
+          if (thread_helper_time_ns() >= deadline)
+            return 1;
+          thread_helper_cpu_relax();
+        }
+      if (!thread_helper_test_and_set_lock(lock))
+        return 0;
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+      thread_helper_backoff(backoff);
+    }
+}
+
+// the number of relax hints executed per thread ahead in the queue, while
+// waiting for a ticket lock
+#define TICKET_BACKOFF 32
+
+// this helper function reads the counters of the ticket lock and of the
+// spinning barrier like thread_helper_load_acquire, so that a thread leaving
+// the wait sees all writes made before the counter was advanced.
+static long
+atomic_load_acquire_long(volatile long *ptr)
+{
+#ifdef _MSC_VER
+  return *ptr;
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void
+thread_helper_ticket_init(thread_helper_ticket_lock_t *lock)
+{
+  lock->next = 0;
+  lock->serving = 0;
+}
+
+void
+thread_helper_ticket_lock(thread_helper_ticket_lock_t *lock)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedExchangeAdd intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedexchangeadd-intrinsic-functions?view=msvc-160
+  long ticket = _InterlockedExchangeAdd(&lock->next, 1);
+#else
+  // gcc and clang Implementation based on __sync_fetch_and_add intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  long ticket = __sync_fetch_and_add(&lock->next, 1);
+#endif
+
+  // the distance is computed in unsigned arithmetic, so that it stays correct
+  // when the counters wrap around
+  unsigned long distance;
+  while ((distance = (unsigned long)ticket - (unsigned long)atomic_load_acquire_long(&lock->serving)) != 0)
+    {
+      unsigned long i;
+      for (i = 0; i < distance * TICKET_BACKOFF; ++i)
+        thread_helper_cpu_relax();
+    }
+}
+
+int
+thread_helper_ticket_trylock(thread_helper_ticket_lock_t *lock)
+{
+  // draw a ticket only if it would be served right away, i.e. if no other
+  // thread holds or waits for the lock
+  long serving = lock->serving;
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedCompareExchange intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedcompareexchange-intrinsic-functions?view=msvc-160
+  return _InterlockedCompareExchange(&lock->next, serving + 1, serving) != serving;
+#else
+  // gcc and clang Implementation based on __sync_bool_compare_and_swap intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return !__sync_bool_compare_and_swap(&lock->next, serving, serving + 1);
+#endif
+}
+
+int
+thread_helper_ticket_timedlock(thread_helper_ticket_lock_t *lock, unsigned long long deadline)
+{
+  // a drawn ticket cannot be given back, so a thread that may give up never
+  // draws one, but tries to acquire the lock whenever it is free
+  for (;;)
+    {
+      if (lock->next == lock->serving && thread_helper_ticket_trylock(lock) == 0)
+        return 0;
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+      thread_helper_cpu_relax();
+    }
+}
+
+void
+thread_helper_ticket_unlock(thread_helper_ticket_lock_t *lock)
+{
+  // only the thread holding the lock advances the serving counter, but the
+  // atomic instruction also acts as a memory barrier, making the writes of the
+  // critical section visible before the next thread enters it
+#ifdef _MSC_VER
+  _InterlockedExchangeAdd(&lock->serving, 1);
+#else
+  __sync_fetch_and_add(&lock->serving, 1);
+#endif
+}
+
+// these helper functions provide the atomic pointer operations used by the
+// queue locks below.
+static void*
+atomic_exchange_pointer(void *volatile *ptr, void *value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedExchangePointer intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedexchangepointer-intrinsic-functions?view=msvc-160
+  return _InterlockedExchangePointer(ptr, value);
+#else
+  // gcc and clang Implementation based on __atomic_exchange_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  return __atomic_exchange_n(ptr, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static int
+atomic_compare_and_swap_pointer(void *volatile *ptr, void *expected, void *value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedCompareExchangePointer intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedcompareexchangepointer-intrinsic-functions?view=msvc-160
+  return _InterlockedCompareExchangePointer(ptr, value, expected) == expected;
+#else
+  // gcc and clang Implementation based on __sync_bool_compare_and_swap intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return __sync_bool_compare_and_swap(ptr, expected, value);
+#endif
+}
+
+static int
+atomic_compare_and_swap_int(volatile int *ptr, int expected, int value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedCompareExchange intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedcompareexchange-intrinsic-functions?view=msvc-160
+  return _InterlockedCompareExchange((volatile long*)ptr, value, expected) == expected;
+#else
+  // gcc and clang Implementation based on __sync_bool_compare_and_swap intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return __sync_bool_compare_and_swap(ptr, expected, value);
+#endif
+}
+
+static int
+atomic_exchange_int(volatile int *ptr, int value)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedExchange intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedexchange-intrinsic-functions?view=msvc-160
+  return _InterlockedExchange((volatile long*)ptr, value);
+#else
+  // gcc and clang Implementation based on __atomic_exchange_n intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  return __atomic_exchange_n(ptr, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static int
+atomic_fetch_and_increment_int(volatile int *ptr)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedIncrement intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockedincrement-intrinsic-functions?view=msvc-160
+  return _InterlockedIncrement((volatile long*)ptr) - 1;
+#else
+  // gcc and clang Implementation based on __sync_fetch_and_add intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return __sync_fetch_and_add(ptr, 1);
+#endif
+}
+
+static int
+atomic_fetch_and_decrement_int(volatile int *ptr)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on _InterlockedDecrement intrinsic
+  //   see: https://docs.microsoft.com/en-us/cpp/intrinsics/interlockeddecrement-intrinsic-functions?view=msvc-160
+  return _InterlockedDecrement((volatile long*)ptr) + 1;
+#else
+  // gcc and clang Implementation based on __sync_fetch_and_sub intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc-4.1.1/gcc/Atomic-Builtins.html
+  return __sync_fetch_and_sub(ptr, 1);
+#endif
+}
+
+void
+thread_helper_mcs_init(thread_helper_mcs_lock_t *lock)
+{
+  lock->tail = NULL;
+}
+
+void
+thread_helper_mcs_lock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node)
+{
+  node->next = NULL;
+  node->locked = 1;
+
+  // append the node to the queue. If there was a predecessor, link the node
+  // to it and wait until it hands over the lock.
+  thread_helper_mcs_node_t *pred = atomic_exchange_pointer((void *volatile *)&lock->tail, node);
+  if (pred != NULL)
+    {
+      pred->next = node;
+      while (thread_helper_load_acquire(&node->locked))
+        thread_helper_cpu_relax();
+    }
+}
+
+int
+thread_helper_mcs_trylock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node)
+{
+  node->next = NULL;
+  node->locked = 0;
+
+  // only append the node if the queue is empty, which acquires the lock. The
+  // compare-and-swap is a full memory barrier, so the critical section sees
+  // all writes of the previous holder, just like after the handoff above.
+  return !atomic_compare_and_swap_pointer((void *volatile *)&lock->tail, NULL, node);
+}
+
+int
+thread_helper_mcs_timedlock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node, unsigned long long deadline)
+{
+  // a node cannot leave the middle of the queue, so a thread that may give up
+  // never enqueues, but tries to acquire the lock whenever the queue is empty
+  for (;;)
+    {
+      if (lock->tail == NULL && thread_helper_mcs_trylock(lock, node) == 0)
+        return 0;
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+      thread_helper_cpu_relax();
+    }
+}
+
+void
+thread_helper_mcs_unlock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node)
+{
+  if (node->next == NULL)
+    {
+      // there is no known successor. If the node is still the tail of the
+      // queue, reset the queue to empty, otherwise a successor is in the
+      // middle of appending itself, so wait until it has linked its node.
+      if (atomic_compare_and_swap_pointer((void *volatile *)&lock->tail, node, NULL))
+        return;
+      while (node->next == NULL)
+        thread_helper_cpu_relax();
+    }
+
+  thread_helper_store_release(&node->next->locked, 0);
+}
+
+void
+thread_helper_clh_init(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t *node)
+{
+  node->locked = 0;
+  node->pred = NULL;
+  lock->tail = node;
+}
+
+void
+thread_helper_clh_lock(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t **node)
+{
+  thread_helper_clh_node_t *self = *node;
+  self->locked = 1;
+
+  // append the node to the queue, and wait until the predecessor is done
+  self->pred = atomic_exchange_pointer((void *volatile *)&lock->tail, self);
+  while (thread_helper_load_acquire(&self->pred->locked))
+    thread_helper_cpu_relax();
+}
+
+void
+thread_helper_clh_unlock(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t **node)
+{
+  (void)lock;
+
+  thread_helper_clh_node_t *self = *node;
+  *node = self->pred;
+  thread_helper_store_release(&self->locked, 0);
+}
+
+// the bounds of the number of relax hints executed by the adaptive lock before
+// a waiting thread is parked
+#define ADAPTIVE_SPIN_MIN 8
+#define ADAPTIVE_SPIN_MAX 512
+
+int
+thread_helper_adaptive_init(thread_helper_adaptive_lock_t *lock)
+{
+  lock->state = 0;
+  lock->spin_estimate = 0;
+  lock->parks = 0;
+#if defined(THREAD_HELPER_HAVE_FUTEX)
+  // Linux Implementation, parking on the state of the lock as a futex
+  return 0;
+#elif defined(_WIN32)
+  // Windows Implementation, parking on a condition variable
+  //   see: https://docs.microsoft.com/en-us/windows/win32/sync/using-condition-variables
+  InitializeCriticalSection(&lock->park_mutex);
+  InitializeConditionVariable(&lock->park_cond);
+  return 0;
+#else
+  // POSIX Implementation, parking on a condition variable
+  //   see: https://man7.org/linux/man-pages/man3/pthread_cond_init.3p.html
+  if (pthread_mutex_init(&lock->park_mutex, NULL) != 0)
+    return 1;
+  return pthread_cond_init(&lock->park_cond, NULL);
+#endif
+}
+
+// these helper functions park the calling thread as long as the adaptive lock
+// is in the contended state 2, and wake up one parked thread. Wake ups may be
+// spurious, so the caller has to check the state of the lock again.
+static void
+adaptive_park(thread_helper_adaptive_lock_t *lock)
+{
+#if defined(THREAD_HELPER_HAVE_FUTEX)
+  futex_wait(&lock->state, 2, NULL);
+#elif defined(_WIN32)
+  EnterCriticalSection(&lock->park_mutex);
+  if (lock->state == 2)
+    SleepConditionVariableCS(&lock->park_cond, &lock->park_mutex, INFINITE);
+  LeaveCriticalSection(&lock->park_mutex);
+#else
+  pthread_mutex_lock(&lock->park_mutex);
+  if (lock->state == 2)
+    pthread_cond_wait(&lock->park_cond, &lock->park_mutex);
+  pthread_mutex_unlock(&lock->park_mutex);
+#endif
+}
+
+static void
+adaptive_unpark(thread_helper_adaptive_lock_t *lock)
+{
+#if defined(THREAD_HELPER_HAVE_FUTEX)
+  futex_wake(&lock->state);
+#elif defined(_WIN32)
+  EnterCriticalSection(&lock->park_mutex);
+  WakeConditionVariable(&lock->park_cond);
+  LeaveCriticalSection(&lock->park_mutex);
+#else
+  pthread_mutex_lock(&lock->park_mutex);
+  pthread_cond_signal(&lock->park_cond);
+  pthread_mutex_unlock(&lock->park_mutex);
+#endif
+}
+
+void
+thread_helper_adaptive_lock(thread_helper_adaptive_lock_t *lock)
+{
+  // spin for up to twice the recent average, within the bounds above. The
+  // average is only updated by the thread holding the lock, so it needs no
+  // atomic instructions.
+  long estimate = lock->spin_estimate;
+  long n, limit = 2 * estimate + ADAPTIVE_SPIN_MIN;
+  if (limit > ADAPTIVE_SPIN_MAX)
+    limit = ADAPTIVE_SPIN_MAX;
+
+  for (n = 0; n < limit; ++n)
+    {
+      if (lock->state == 0 && atomic_compare_and_swap_int(&lock->state, 0, 1))
+        {
+          lock->spin_estimate = estimate + (n - estimate) / 8;
+          return;
+        }
+      thread_helper_cpu_relax();
+    }
+
+  // spinning failed, mark the lock as contended and park until it is released
+  int c = atomic_exchange_int(&lock->state, 2);
+  while (c != 0)
+    {
+#ifdef _MSC_VER
+      _InterlockedIncrement(&lock->parks);
+#else
+      __sync_fetch_and_add(&lock->parks, 1);
+#endif
+      adaptive_park(lock);
+      c = atomic_exchange_int(&lock->state, 2);
+    }
+  lock->spin_estimate = estimate - estimate / 8;
+}
+
+int
+thread_helper_adaptive_trylock(thread_helper_adaptive_lock_t *lock)
+{
+  // the lock is only taken if it is free, which leaves the state of a
+  // contended lock to the threads that park on it
+  return !(lock->state == 0 && atomic_compare_and_swap_int(&lock->state, 0, 1));
+}
+
+int
+thread_helper_adaptive_timedlock(thread_helper_adaptive_lock_t *lock, unsigned long long deadline)
+{
+  for (;;)
+    {
+      if (thread_helper_adaptive_trylock(lock) == 0)
+        return 0;
+      if (thread_helper_time_ns() >= deadline)
+        return 1;
+      thread_helper_cpu_relax();
+    }
+}
+
+void
+thread_helper_adaptive_unlock(thread_helper_adaptive_lock_t *lock)
+{
+  // the lock was not contended, no thread needs to be woken up
+  if (atomic_fetch_and_decrement_int(&lock->state) == 1)
+    return;
+
+  thread_helper_store_release(&lock->state, 0);
+  adaptive_unpark(lock);
+}
+
+// Cohort lock Implementation based on lock cohorting, with ticket locks as
+// both the global and the local locks. The global lock may be released by
+// another thread than the one that acquired it, and the local lock tells if
+// other threads of the node are waiting, as required by lock cohorting.
+//   see: https://dl.acm.org/doi/10.1145/2686884
+void
+thread_helper_cohort_init(thread_helper_cohort_lock_t *lock, unsigned long bound)
+{
+  int i;
+  thread_helper_ticket_init(&lock->global);
+  lock->bound = bound;
+  lock->last_node = -1;
+  lock->local_handoffs = 0;
+  lock->global_handoffs = 0;
+  lock->cross_node_handoffs = 0;
+  for (i = 0; i < THREAD_HELPER_COHORT_NODES; ++i)
+    {
+      thread_helper_ticket_init(&lock->nodes[i].lock);
+      lock->nodes[i].global_owned = 0;
+      lock->nodes[i].passes = 0;
+    }
+}
+
+void
+thread_helper_cohort_lock(thread_helper_cohort_lock_t *lock, int node)
+{
+  thread_helper_cohort_node_t *local = &lock->nodes[node % THREAD_HELPER_COHORT_NODES];
+  thread_helper_ticket_lock(&local->lock);
+
+  // the global lock was passed on by the previous holder of the local lock
+  if (local->global_owned)
+    return;
+
+  thread_helper_ticket_lock(&lock->global);
+  local->global_owned = 1;
+
+  // the statistics are only updated while holding the global lock
+  if (lock->last_node >= 0 && lock->last_node != node)
+    lock->cross_node_handoffs++;
+  lock->last_node = node;
+}
+
+void
+thread_helper_cohort_unlock(thread_helper_cohort_lock_t *lock, int node)
+{
+  thread_helper_cohort_node_t *local = &lock->nodes[node % THREAD_HELPER_COHORT_NODES];
+
+  // other threads of the node are waiting if tickets beyond the one of the
+  // current holder have been drawn
+  int waiting = (unsigned long)local->lock.next - (unsigned long)local->lock.serving > 1;
+  if (waiting && local->passes < lock->bound)
+    {
+      local->passes++;
+      lock->local_handoffs++;
+      thread_helper_ticket_unlock(&local->lock);
+      return;
+    }
+
+  local->passes = 0;
+  local->global_owned = 0;
+  lock->global_handoffs++;
+  thread_helper_ticket_unlock(&lock->global);
+  thread_helper_ticket_unlock(&local->lock);
+}
+
+// the reader-writer spin-lock and the big reader lock below rely on the full
+// memory barrier of the atomic read-modify-write instructions: a reader first
+// announces itself and then checks for a writer, while a writer first raises
+// its flag and then checks for readers, so that at least one of them sees the
+// other. The check that admits a reader or a writer is a load with acquire
+// ordering, so that it sees the data as left by the last release.
+void
+thread_helper_spin_rwlock_init(thread_helper_spin_rwlock_t *lock)
+{
+  lock->readers = 0;
+  lock->writer = 0;
+}
+
+void
+thread_helper_spin_rwlock_read_lock(thread_helper_spin_rwlock_t *lock)
+{
+  for (;;)
+    {
+      while (lock->writer)
+        thread_helper_cpu_relax();
+      atomic_fetch_and_increment_int(&lock->readers);
+      if (!thread_helper_load_acquire(&lock->writer))
+        return;
+
+      // a writer arrived in the meantime, let it go first
+      atomic_fetch_and_decrement_int(&lock->readers);
+    }
+}
+
+void
+thread_helper_spin_rwlock_read_unlock(thread_helper_spin_rwlock_t *lock)
+{
+  atomic_fetch_and_decrement_int(&lock->readers);
+}
+
+void
+thread_helper_spin_rwlock_write_lock(thread_helper_spin_rwlock_t *lock)
+{
+  while (lock->writer || !atomic_compare_and_swap_int(&lock->writer, 0, 1))
+    thread_helper_cpu_relax();
+  while (thread_helper_load_acquire(&lock->readers))
+    thread_helper_cpu_relax();
+}
+
+void
+thread_helper_spin_rwlock_write_unlock(thread_helper_spin_rwlock_t *lock)
+{
+  thread_helper_store_release(&lock->writer, 0);
+}
+
+// Big reader lock Implementation based on the brlock of the Linux kernel
+//   see: https://lwn.net/Articles/378911/
+void
+thread_helper_brlock_init(thread_helper_brlock_t *lock, thread_helper_brlock_slot_t *slots, size_t nslots)
+{
+  size_t i;
+  lock->writer = 0;
+  lock->slots = slots;
+  lock->nslots = nslots;
+  for (i = 0; i < nslots; ++i)
+    slots[i].active = 0;
+}
+
+void
+thread_helper_brlock_read_lock(thread_helper_brlock_t *lock, size_t slot)
+{
+  thread_helper_brlock_slot_t *self = &lock->slots[slot];
+  for (;;)
+    {
+      while (lock->writer)
+        thread_helper_cpu_relax();
+      atomic_compare_and_swap_int(&self->active, 0, 1);
+      if (!thread_helper_load_acquire(&lock->writer))
+        return;
+
+      // a writer arrived in the meantime, let it go first
+      thread_helper_store_release(&self->active, 0);
+    }
+}
+
+void
+thread_helper_brlock_read_unlock(thread_helper_brlock_t *lock, size_t slot)
+{
+  thread_helper_store_release(&lock->slots[slot].active, 0);
+}
+
+void
+thread_helper_brlock_write_lock(thread_helper_brlock_t *lock)
+{
+  size_t i;
+  while (lock->writer || !atomic_compare_and_swap_int(&lock->writer, 0, 1))
+    thread_helper_cpu_relax();
+  for (i = 0; i < lock->nslots; ++i)
+    while (thread_helper_load_acquire(&lock->slots[i].active))
+      thread_helper_cpu_relax();
+}
+
+void
+thread_helper_brlock_write_unlock(thread_helper_brlock_t *lock)
+{
+  thread_helper_store_release(&lock->writer, 0);
+}
+
+// this helper function orders the memory accesses before the fence against
+// the memory accesses after it.
+static void
+memory_fence(void)
+{
+#ifdef _MSC_VER
+  // cl.exe Implementation based on the MemoryBarrier macro
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-memorybarrier
+  MemoryBarrier();
+#else
+  // gcc and clang Implementation based on __atomic_thread_fence intrinsic
+  //   see: https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+// these helper functions read and write the unsigned sequence counter of the
+// sequence lock below, like thread_helper_load_acquire and
+// thread_helper_store_release.
+static unsigned
+atomic_load_acquire_unsigned(volatile unsigned *ptr)
+{
+#ifdef _MSC_VER
+  return *ptr;
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void
+atomic_store_release_unsigned(volatile unsigned *ptr, unsigned value)
+{
+#ifdef _MSC_VER
+  *ptr = value;
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Sequence lock Implementation based on the seqlock of the Linux kernel
+//   see: https://www.kernel.org/doc/html/latest/locking/seqlock.html
+void
+thread_helper_seqlock_init(thread_helper_seqlock_t *lock)
+{
+  lock->sequence = 0;
+  lock->writer = 0;
+}
+
+unsigned
+thread_helper_seqlock_read_begin(thread_helper_seqlock_t *lock)
+{
+  unsigned sequence;
+  while ((sequence = atomic_load_acquire_unsigned(&lock->sequence)) & 1)
+    thread_helper_cpu_relax();
+  return sequence;
+}
+
+int
+thread_helper_seqlock_read_retry(thread_helper_seqlock_t *lock, unsigned sequence)
+{
+  // the reads of the data must be complete before the counter is read again
+  memory_fence();
+  return lock->sequence != sequence;
+}
+
+void
+thread_helper_seqlock_write_lock(thread_helper_seqlock_t *lock)
+{
+  while (lock->writer || !atomic_compare_and_swap_int(&lock->writer, 0, 1))
+    thread_helper_cpu_relax();
+
+  // the odd counter must be visible before any write to the data
+  lock->sequence = lock->sequence + 1;
+  memory_fence();
+}
+
+void
+thread_helper_seqlock_write_unlock(thread_helper_seqlock_t *lock)
+{
+  atomic_store_release_unsigned(&lock->sequence, lock->sequence + 1);
+  thread_helper_store_release(&lock->writer, 0);
+}
+
+int
+thread_helper_barrier_init(thread_helper_barrier_t *barrier, unsigned count)
+{
+#ifdef THREAD_HELPER_SPIN_BARRIER
+  // Spinning Implementation, see thread_helper_barrier_wait below
+  barrier->count = 0;
+  barrier->generation = 0;
+  barrier->total = count;
+  return 0;
+#else
+  // POSIX Implementation based on pthread_barrier_init
+  //   see: https://man7.org/linux/man-pages/man3/pthread_barrier_init.3p.html
+  return pthread_barrier_init(barrier, NULL, count);
+#endif
+}
+
+int
+thread_helper_barrier_wait(thread_helper_barrier_t *barrier)
+{
+#ifdef THREAD_HELPER_SPIN_BARRIER
+  // Spinning Implementation based on an atomic counter of arrived threads.
+  // The last arriving thread resets the counter and advances the generation,
+  // which releases the threads spinning on the previous generation. They read
+  // the generation with acquire ordering, so that they see all writes made
+  // before the barrier, such as the job handed over by the pool.
+  long generation = barrier->generation;
+#ifdef _MSC_VER
+  long arrived = _InterlockedIncrement(&barrier->count);
+#else
+  long arrived = __sync_add_and_fetch(&barrier->count, 1);
+#endif
+  if (arrived == barrier->total)
+    {
+      barrier->count = 0;
+#ifdef _MSC_VER
+      _InterlockedIncrement(&barrier->generation);
+#else
+      __sync_add_and_fetch(&barrier->generation, 1);
+#endif
+      return 0;
+    }
+  while (atomic_load_acquire_long(&barrier->generation) == generation)
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  return 0;
+#else
+  // POSIX Implementation based on pthread_barrier_wait
+  //   see: https://man7.org/linux/man-pages/man3/pthread_barrier_wait.3p.html
+  int res = pthread_barrier_wait(barrier);
+  return (res == 0 || res == PTHREAD_BARRIER_SERIAL_THREAD) ? 0 : res;
+#endif
+}
+
+int
+thread_helper_barrier_destroy(thread_helper_barrier_t *barrier)
+{
+#ifdef THREAD_HELPER_SPIN_BARRIER
+  // Spinning Implementation, nothing to free
+  (void)barrier;
+  return 0;
+#else
+  // POSIX Implementation based on pthread_barrier_destroy
+  //   see: https://man7.org/linux/man-pages/man3/pthread_barrier_init.3p.html
+  return pthread_barrier_destroy(barrier);
+#endif
+}
+
+// Worker pool Implementation based on two barriers, shared by the workers and
+// the thread dispatching the jobs: the start barrier releases the workers into
+// the next job, or into their termination, and the done barrier releases the
+// dispatching thread once all workers have finished the job. Between two jobs,
+// the workers are blocked at the start barrier. Before the first job, the
+// workers wait until all of them have been created, so that they can still be
+// terminated without the barrier if creating one of them fails.
+static thread_helper_return_t
+pool_worker(void *arg)
+{
+  thread_helper_pool_worker_t *worker = arg;
+  thread_helper_pool_t *pool = worker->pool;
+
+  while (!thread_helper_load_acquire(&pool->ready))
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  if (pool->stop)
+    return 0;
+
+  for (;;)
+    {
+      thread_helper_barrier_wait(&pool->start);
+      if (pool->stop)
+        break;
+      pool->func(pool->args + worker->index * pool->size);
+      thread_helper_barrier_wait(&pool->done);
+    }
+
+  return 0;
+}
+
+int
+thread_helper_pool_init(thread_helper_pool_t *pool, thread_helper_pool_worker_t *workers, size_t count, const int *cpus)
+{
+  pool->workers = workers;
+  pool->nworkers = count;
+  pool->func = NULL;
+  pool->args = NULL;
+  pool->size = 0;
+  pool->ready = 0;
+  pool->stop = 0;
+
+  if (thread_helper_barrier_init(&pool->start, count + 1) != 0)
+    return 1;
+  if (thread_helper_barrier_init(&pool->done, count + 1) != 0)
+    {
+      thread_helper_barrier_destroy(&pool->start);
+      return 1;
+    }
+
+  size_t i;
+  for (i = 0; i < count; ++i)
+    {
+      workers[i].pool = pool;
+      workers[i].index = i;
+      if (thread_helper_create_on_cpu(&workers[i].thread, pool_worker, workers + i, cpus ? cpus[i] : -1) != 0)
+        {
+          // release the workers created so far into their termination, and
+          // join them again
+          pool->stop = 1;
+          thread_helper_store_release(&pool->ready, 1);
+          while (i > 0)
+            thread_helper_join(workers[--i].thread);
+          thread_helper_barrier_destroy(&pool->start);
+          thread_helper_barrier_destroy(&pool->done);
+          return 1;
+        }
+    }
+  thread_helper_store_release(&pool->ready, 1);
+  return 0;
+}
+
+int
+thread_helper_pool_run(thread_helper_pool_t *pool, thread_func_t func, void *args, size_t size)
+{
+  pool->func = func;
+  pool->args = args;
+  pool->size = size;
+  if (thread_helper_barrier_wait(&pool->start) != 0)
+    return 1;
+  return thread_helper_barrier_wait(&pool->done) != 0;
+}
+
+int
+thread_helper_pool_destroy(thread_helper_pool_t *pool)
+{
+  int res = 0;
+  size_t i;
+
+  pool->stop = 1;
+  if (thread_helper_barrier_wait(&pool->start) != 0)
+    return 1;
+  for (i = 0; i < pool->nworkers; ++i)
+    res |= thread_helper_join(pool->workers[i].thread) != 0;
+  res |= thread_helper_barrier_destroy(&pool->start) != 0;
+  res |= thread_helper_barrier_destroy(&pool->done) != 0;
+  return res;
+}
+
+unsigned long long
+thread_helper_time_ns(void)
+{
+#ifdef _WIN32
+  // Windows Implementation based on QueryPerformanceCounter
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/profileapi/nf-profileapi-queryperformancecounter
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (unsigned long long)(count.QuadPart / freq.QuadPart) * 1000000000ULL
+    + (unsigned long long)(count.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart;
+#else
+  // POSIX Implementation based on clock_gettime with CLOCK_MONOTONIC
+  //   see: https://man7.org/linux/man-pages/man3/clock_gettime.3.html
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+unsigned long long
+thread_helper_thread_cpu_time_ns(void)
+{
+#ifdef _WIN32
+  // Windows Implementation based on GetThreadTimes, in units of 100ns
+  //   see: https://docs.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-getthreadtimes
+  FILETIME creation, exit, kernel, user;
+  GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime;
+  k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;
+  u.HighPart = user.dwHighDateTime;
+  return (k.QuadPart + u.QuadPart) * 100ULL;
+#else
+  // POSIX Implementation based on clock_gettime with CLOCK_THREAD_CPUTIME_ID
+  //   see: https://man7.org/linux/man-pages/man3/clock_gettime.3.html
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+#ifdef THREAD_HELPER_HAVE_PERF
+// this helper function opens a counter for the given event of the calling
+// thread, as a member of the group of the given leader, or as a new group if
+// the leader is -1. Only events in user mode are counted, which is permitted
+// to unprivileged users by default.
+static int
+perf_event_open(unsigned type, unsigned long long config, int leader)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = leader == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+// this helper function reads the voluntary and involuntary context switches of
+// the calling thread.
+static void
+read_context_switches(long *voluntary, long *involuntary)
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_THREAD, &usage) != 0)
+    {
+      *voluntary = *involuntary = 0;
+      return;
+    }
+  *voluntary = usage.ru_nvcsw;
+  *involuntary = usage.ru_nivcsw;
+}
+#endif
+
+int
+thread_helper_counters_open(thread_helper_counters_t *counters)
+{
+  memset(counters, 0, sizeof(*counters));
+#ifdef THREAD_HELPER_HAVE_PERF
+  // Linux Implementation based on perf_event_open and getrusage
+  //   see: https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+  int leader = perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (leader >= 0)
+    {
+      counters->fds[counters->nfds++] = leader;
+      counters->hardware = 1;
+      int fd = perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+      if (fd >= 0)
+        counters->fds[counters->nfds++] = fd;
+      fd = perf_event_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader);
+      if (fd >= 0)
+        counters->fds[counters->nfds++] = fd;
+      if (counters->nfds < 3)
+        {
+          // a partial group of hardware counters is not reported
+          while (counters->nfds > 0)
+            close(counters->fds[--counters->nfds]);
+          counters->hardware = 0;
+          leader = -1;
+        }
+    }
+
+  int fd = perf_event_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, leader);
+  if (fd >= 0)
+    counters->fds[counters->nfds++] = fd;
+
+  // the context switches are counted by the kernel in any case
+  read_context_switches(&counters->voluntary_switches, &counters->involuntary_switches);
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+void
+thread_helper_counters_start(thread_helper_counters_t *counters)
+{
+#ifdef THREAD_HELPER_HAVE_PERF
+  read_context_switches(&counters->voluntary_switches, &counters->involuntary_switches);
+  if (counters->nfds > 0)
+    {
+      ioctl(counters->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(counters->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+  (void)counters;
+#endif
+}
+
+void
+thread_helper_counters_stop(thread_helper_counters_t *counters)
+{
+#ifdef THREAD_HELPER_HAVE_PERF
+  unsigned long long values[1 + THREAD_HELPER_COUNTER_EVENTS];
+  long voluntary, involuntary;
+
+  if (counters->nfds > 0)
+    ioctl(counters->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  read_context_switches(&voluntary, &involuntary);
+  counters->voluntary_switches = voluntary - counters->voluntary_switches;
+  counters->involuntary_switches = involuntary - counters->involuntary_switches;
+
+  // a group is read at once, as the number of events followed by their values
+  // in the order the events were added to the group
+  if (counters->nfds > 0 && read(counters->fds[0], values, sizeof(values)) > 0 && values[0] == (unsigned long long)counters->nfds)
+    {
+      if (counters->hardware)
+        {
+          counters->cycles = values[1];
+          counters->instructions = values[2];
+          counters->cache_misses = values[3];
+        }
+      if (counters->nfds > (counters->hardware ? 3 : 0))
+        counters->migrations = values[counters->nfds];
+    }
+
+  while (counters->nfds > 0)
+    close(counters->fds[--counters->nfds]);
+#else
+  (void)counters;
+#endif
+}
+
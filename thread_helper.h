@@ -12,22 +12,243 @@
 typedef HANDLE thread_helper_t;
 typedef DWORD thread_helper_return_t;
 
-typedef CRITICAL_SECTION thread_helper_mutex_t;
+typedef CRITICAL_SECTION thread_helper_native_mutex_t;
+typedef CONDITION_VARIABLE thread_helper_native_cond_t;
+typedef SRWLOCK thread_helper_rwlock_t;
 #else
 // Declarations compatible with POSIX Threads
 #include <pthread.h>
+#include <unistd.h>
 
 typedef pthread_t thread_helper_t;
 typedef void* thread_helper_return_t;
 
-typedef pthread_mutex_t thread_helper_mutex_t;
+typedef pthread_mutex_t thread_helper_native_mutex_t;
+typedef pthread_cond_t thread_helper_native_cond_t;
+typedef pthread_rwlock_t thread_helper_rwlock_t;
+
+#if defined(_POSIX_BARRIERS) && _POSIX_BARRIERS > 0
+typedef pthread_barrier_t thread_helper_barrier_t;
+#endif
+#endif
+
+// Declarations for a mutex, implemented either by the operating system api, or
+// directly on top of futexes on Linux. The futex implementation counts the
+// system calls it makes.
+#ifdef __linux__
+#define THREAD_HELPER_HAVE_FUTEX
+#endif
+
+enum thread_helper_mutex_type_t
+{
+  THREAD_HELPER_MUTEX_NATIVE,
+  THREAD_HELPER_MUTEX_FUTEX
+};
+
+typedef struct
+{
+  enum thread_helper_mutex_type_t type;
+  thread_helper_native_mutex_t native;
+  volatile int futex;
+  volatile long futex_waits;
+  volatile long futex_wakes;
+} thread_helper_mutex_t;
+
+// Declarations for a spinning barrier, used on systems without native barriers
+// such as Windows and MacOS
+#if defined(_WIN32) || !(defined(_POSIX_BARRIERS) && _POSIX_BARRIERS > 0)
+#define THREAD_HELPER_SPIN_BARRIER
+
+typedef struct
+{
+  volatile long count;
+  volatile long generation;
+  long total;
+} thread_helper_barrier_t;
+#endif
+
+// Declarations to align objects to the size of a cache line. Objects aligned
+// this way do not share a cache line with any other object, so writes to them
+// do not invalidate the cached copies of unrelated objects on other CPUs.
+#define THREAD_HELPER_CACHE_LINE 64
+
+#ifdef _MSC_VER
+#define THREAD_HELPER_CACHE_ALIGNED __declspec(align(THREAD_HELPER_CACHE_LINE))
+#else
+#define THREAD_HELPER_CACHE_ALIGNED __attribute__((aligned(THREAD_HELPER_CACHE_LINE)))
+#endif
+
+// Declarations for a bounded, randomized exponential backoff
+typedef struct
+{
+  unsigned long min;
+  unsigned long max;
+  unsigned long limit;
+  unsigned long seed;
+} thread_helper_backoff_t;
+
+// Declarations for a ticket lock, based on atomic fetch_and_add
+typedef struct
+{
+  volatile long next;
+  volatile long serving;
+} thread_helper_ticket_lock_t;
+
+// Declarations for the MCS queue lock, based on atomic exchange and
+// compare_and_swap, where every thread waits on its own cache line aligned node
+typedef struct THREAD_HELPER_CACHE_ALIGNED thread_helper_mcs_node
+{
+  struct thread_helper_mcs_node *volatile next;
+  volatile int locked;
+} thread_helper_mcs_node_t;
+
+typedef struct
+{
+  thread_helper_mcs_node_t *volatile tail;
+} thread_helper_mcs_lock_t;
+
+// Declarations for the CLH queue lock, based on atomic exchange, where every
+// thread waits on the cache line aligned node of its predecessor
+typedef struct THREAD_HELPER_CACHE_ALIGNED thread_helper_clh_node
+{
+  volatile int locked;
+  struct thread_helper_clh_node *pred;
+} thread_helper_clh_node_t;
+
+typedef struct
+{
+  thread_helper_clh_node_t *volatile tail;
+} thread_helper_clh_lock_t;
+
+// Declarations for an adaptive lock, that spins for a self-tuning number of
+// iterations before it parks the waiting thread, using a futex on Linux and a
+// condition variable elsewhere
+typedef struct
+{
+  volatile int state;
+  volatile long spin_estimate;
+  volatile long parks;
+#ifndef THREAD_HELPER_HAVE_FUTEX
+  thread_helper_native_mutex_t park_mutex;
+  thread_helper_native_cond_t park_cond;
+#endif
+} thread_helper_adaptive_lock_t;
+
+// Declarations for a cohort lock, made of a global ticket lock and one local
+// ticket lock per NUMA node, where every local lock is kept on its own cache
+// line
+#define THREAD_HELPER_COHORT_NODES 64
+
+typedef struct THREAD_HELPER_CACHE_ALIGNED
+{
+  thread_helper_ticket_lock_t lock;
+  volatile int global_owned;
+  unsigned long passes;
+} thread_helper_cohort_node_t;
+
+typedef struct
+{
+  thread_helper_ticket_lock_t global;
+  unsigned long bound;
+  int last_node;
+  long local_handoffs;
+  long global_handoffs;
+  long cross_node_handoffs;
+  thread_helper_cohort_node_t nodes[THREAD_HELPER_COHORT_NODES];
+} thread_helper_cohort_lock_t;
+
+// Declarations for a writer-preferring reader-writer spin-lock, based on an
+// atomic counter of the readers and a flag of the writer
+typedef struct
+{
+  volatile int readers;
+  volatile int writer;
+} thread_helper_spin_rwlock_t;
+
+// Declarations for a big reader lock, where every reader announces itself in
+// its own cache line aligned slot
+typedef struct THREAD_HELPER_CACHE_ALIGNED
+{
+  volatile int active;
+} thread_helper_brlock_slot_t;
+
+typedef struct
+{
+  volatile int writer;
+  thread_helper_brlock_slot_t *slots;
+  size_t nslots;
+} thread_helper_brlock_t;
+
+// Declarations for a sequence lock, based on a sequence counter that is odd
+// while a writer modifies the protected data
+typedef struct
+{
+  volatile unsigned sequence;
+  volatile int writer;
+} thread_helper_seqlock_t;
+
+// Declarations for the performance counters of a thread, based on the
+// perf_event_open system call on Linux. Hardware counters are often not
+// available in virtual machines, in which case only the software counters and
+// the context switches are collected.
+#ifdef __linux__
+#define THREAD_HELPER_HAVE_PERF
 #endif
 
+#define THREAD_HELPER_COUNTER_EVENTS 4
+
+typedef struct
+{
+  int fds[THREAD_HELPER_COUNTER_EVENTS];
+  int nfds;
+  int hardware;
+  unsigned long long cycles;
+  unsigned long long instructions;
+  unsigned long long cache_misses;
+  unsigned long long migrations;
+  long voluntary_switches;
+  long involuntary_switches;
+} thread_helper_counters_t;
+
 // based on the definitions and declarations above, declare portable functions
 // for thread creation and thread join
 
 typedef thread_helper_return_t(*thread_func_t)(void*);
 
+// Declarations for a pool of worker threads, which are created once and then
+// run any number of jobs, waiting at a barrier in between
+struct thread_helper_pool;
+
+typedef struct
+{
+  thread_helper_t thread;
+  struct thread_helper_pool *pool;
+  size_t index;
+} thread_helper_pool_worker_t;
+
+typedef struct thread_helper_pool
+{
+  thread_helper_pool_worker_t *workers;
+  size_t nworkers;
+  thread_helper_barrier_t start;
+  thread_helper_barrier_t done;
+  thread_func_t func;
+  char *args;
+  size_t size;
+  volatile int ready;
+  volatile int stop;
+} thread_helper_pool_t;
+
+// Declarations for the topology of the CPUs of the system, as reported by the
+// operating system. The CPU numbers are the ones used to pin threads.
+typedef struct
+{
+  int cpu;
+  int core;
+  int package;
+  int node;
+} thread_helper_cpu_t;
+
 // thread_helper_create
 //
 //   this function creates a new thread that starts executing the given
@@ -51,6 +272,65 @@ typedef thread_helper_return_t(*thread_func_t)(void*);
 //   the function returns 0 on success, and 1 otherwise.
 int thread_helper_create(thread_helper_t *thread, thread_helper_return_t(*thread_func)(void*), void *arg);
 
+// thread_helper_create_on_cpu
+//
+//   this function creates a new thread like thread_helper_create, but pins the
+//   thread to the given CPU before it starts executing, so that the operating
+//   system will only ever schedule it on that CPU. Pinning threads makes it
+//   possible to control whether the caches they communicate through are
+//   shared, e.g. between the hyper-threads of one core, or not shared at all,
+//   e.g. between cores in different CPU packages.
+//
+//   Pinning threads is supported on Linux and on Windows, for the first 64
+//   CPUs. On other systems the thread is created without pinning.
+//
+// parameters:
+//
+//   thread, thread_func, arg - see thread_helper_create
+//
+//   cpu - the number of the CPU to pin the thread to, as reported by
+//   thread_helper_topology, or -1 to create the thread without pinning.
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_create_on_cpu(thread_helper_t *thread, thread_helper_return_t(*thread_func)(void*), void *arg, int cpu);
+
+// thread_helper_topology
+//
+//   this function describes the CPUs the calling process may run on. For each
+//   CPU, it reports the core it belongs to, the CPU package (or socket) the
+//   core belongs to, and the NUMA node that is closest to the CPU. Two CPUs
+//   with the same core and package are hyper-threads of the same core.
+//
+//   On Linux, the topology is read from /sys/devices/system/cpu, and only the
+//   CPUs the process is allowed to run on, e.g. with taskset, are reported. On
+//   other systems, every CPU is reported as its own core, in package 0 and
+//   node 0.
+//
+// parameters:
+//
+//   cpus - a pointer to an array of thread_helper_cpu_t to fill
+//
+//   max - the number of elements of the array
+//
+// return value:
+//
+//   the function returns the number of CPUs stored in the array.
+int thread_helper_topology(thread_helper_cpu_t *cpus, int max);
+
+// thread_helper_current_cpu
+//
+//   this function returns the number of the CPU the calling thread is running
+//   on, as reported by thread_helper_topology. Unless the thread is pinned, the
+//   operating system may move it to another CPU at any time, so the result may
+//   already be outdated when it is returned.
+//
+// return value:
+//
+//   the function returns the number of the CPU, or -1 if it is not known.
+int thread_helper_current_cpu(void);
+
 // thread_helper_join
 //
 //   this function joins a previously created thread. This means that it waits
@@ -85,6 +365,37 @@ int thread_helper_join(thread_helper_t thread);
 //   the function returns 0 on success, and 1 otherwise.
 int thread_helper_mutex_init(thread_helper_mutex_t *mutex);
 
+// thread_helper_mutex_init_type
+//
+//   this function initializes a thread mutex like thread_helper_mutex_init,
+//   but allows to choose its implementation at runtime. Mutexes of type
+//   THREAD_HELPER_MUTEX_NATIVE use the operating system api, just like those
+//   initialized by thread_helper_mutex_init. Mutexes of type
+//   THREAD_HELPER_MUTEX_FUTEX are only available on Linux, and are
+//   implemented directly on top of the futex system call.
+//
+//   A futex is a memory location that the kernel allows threads to sleep on
+//   until another thread wakes them up. The futex mutex stores one of three
+//   states in it: 0 when it is unlocked, 1 when it is locked, and 2 when it is
+//   locked and threads may be sleeping on it. Locking and unlocking a mutex
+//   that no other thread is waiting for only takes a single atomic instruction
+//   and no system call at all. Only when the mutex is contended, the waiting
+//   threads call into the kernel to sleep, and the unlocking thread calls into
+//   the kernel to wake one of them up.
+//
+// parameters:
+//
+//   mutex - a pointer to a thread_helper_mutex_t that holds the reference to
+//   the mutex object in the used implementation
+//
+//   type - the implementation of the mutex
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise, e.g. if the type is
+//   not supported by the operating system.
+int thread_helper_mutex_init_type(thread_helper_mutex_t *mutex, enum thread_helper_mutex_type_t type);
+
 // thread_helper_mutex_lock
 //
 //   this function locks a mutex. To correctly syncronize access to a critical
@@ -111,6 +422,43 @@ int thread_helper_mutex_init(thread_helper_mutex_t *mutex);
 //   the function returns 0 on success, and 1 otherwise.
 int thread_helper_mutex_lock(thread_helper_mutex_t *mutex);
 
+// thread_helper_mutex_trylock
+//
+//   this function acquires a mutex like thread_helper_mutex_lock, but only if
+//   it is not held by another thread. Instead of waiting for the mutex, the
+//   calling thread can then do something else, and try again later.
+//
+// parameters:
+//
+//   mutex - a pointer to a thread_helper_mutex_t that holds the reference to
+//   the mutex object in the used implementation
+//
+// return value:
+//
+//   the function returns 0 if the mutex was acquired, and non-zero otherwise.
+int thread_helper_mutex_trylock(thread_helper_mutex_t *mutex);
+
+// thread_helper_mutex_timedlock
+//
+//   this function acquires a mutex like thread_helper_mutex_lock, but gives up
+//   waiting for it at the given deadline. The mutex is tried at least once,
+//   even if the deadline has already passed.
+//
+//   On systems without timed mutexes, such as Windows and MacOS, the mutex is
+//   tried repeatedly until the deadline, yielding the CPU in between.
+//
+// parameters:
+//
+//   mutex - a pointer to a thread_helper_mutex_t that holds the reference to
+//   the mutex object in the used implementation
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the mutex was acquired, and non-zero otherwise.
+int thread_helper_mutex_timedlock(thread_helper_mutex_t *mutex, unsigned long long deadline);
+
 // thread_helper_mutex_unlock
 //
 //   this function releases a mutex previously acquired by
@@ -127,6 +475,96 @@ int thread_helper_mutex_lock(thread_helper_mutex_t *mutex);
 //   the function returns 0 on success, and 1 otherwise
 int thread_helper_mutex_unlock(thread_helper_mutex_t *mutex);
 
+// thread_helper_mutex_syscalls
+//
+//   this function reports the number of futex system calls made by a mutex of
+//   type THREAD_HELPER_MUTEX_FUTEX, and resets the counts to zero. For mutexes
+//   of other types, the system calls are made inside the operating system
+//   library and cannot be counted, and both counts are zero.
+//
+// parameters:
+//
+//   mutex - a pointer to a thread_helper_mutex_t that holds the reference to
+//   the mutex object in the used implementation
+//
+//   waits - a pointer to store the number of calls to sleep on the futex
+//
+//   wakes - a pointer to store the number of calls to wake a sleeping thread
+void thread_helper_mutex_syscalls(thread_helper_mutex_t *mutex, long *waits, long *wakes);
+
+// thread_helper_rwlock_init
+//
+//   this function initializes a reader-writer lock of the operating system.
+//   In contrast to a mutex, a reader-writer lock distinguishes threads that
+//   only read the shared resource from threads that modify it: any number of
+//   readers may hold the lock at the same time, while a writer holds it
+//   exclusively.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_rwlock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_rwlock_init(thread_helper_rwlock_t *lock);
+
+// thread_helper_rwlock_read_lock
+//
+//   this function locks a reader-writer lock for reading. It blocks while a
+//   writer holds the lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_rwlock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_rwlock_read_lock(thread_helper_rwlock_t *lock);
+
+// thread_helper_rwlock_read_unlock
+//
+//   this function unlocks a reader-writer lock previously locked by
+//   thread_helper_rwlock_read_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_rwlock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_rwlock_read_unlock(thread_helper_rwlock_t *lock);
+
+// thread_helper_rwlock_write_lock
+//
+//   this function locks a reader-writer lock for writing. It blocks while
+//   any other thread, reader or writer, holds the lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_rwlock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_rwlock_write_lock(thread_helper_rwlock_t *lock);
+
+// thread_helper_rwlock_write_unlock
+//
+//   this function unlocks a reader-writer lock previously locked by
+//   thread_helper_rwlock_write_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_rwlock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_rwlock_write_unlock(thread_helper_rwlock_t *lock);
+
 // thread_helper_test_and_set_lock
 //
 //   this function performs an atomic test_and_set instruction on the location
@@ -171,4 +609,860 @@ int thread_helper_test_and_set_lock(int *lock);
 //   lock - a pointer to a valid memory location
 void thread_helper_test_and_set_unlock(int *lock);
 
+// thread_helper_test_and_set_timedlock
+//
+//   this function locks a spin-lock like thread_helper_test_and_set_lock, but
+//   keeps trying until it succeeds, or until the given deadline has passed. A
+//   single call of thread_helper_test_and_set_lock already is the try-lock of
+//   a spin-lock.
+//
+// parameters:
+//
+//   lock - a pointer to a valid memory location
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_test_and_set_timedlock(int *lock, unsigned long long deadline);
+
+// thread_helper_load_acquire
+//
+//   this function reads an integer from memory, such that no memory access of
+//   the calling thread that follows the read in program order is executed
+//   before it. Together with thread_helper_store_release, this allows one
+//   thread to publish data to another: all writes made before the release are
+//   visible to a thread after it has read the released value with acquire.
+//
+// parameters:
+//
+//   ptr - a pointer to a valid memory location
+//
+// return value:
+//
+//   this function returns the value stored at the given memory location
+int thread_helper_load_acquire(volatile int *ptr);
+
+// thread_helper_store_release
+//
+//   this function writes an integer to memory, such that no memory access of
+//   the calling thread that precedes the write in program order is executed
+//   after it.
+//
+// parameters:
+//
+//   ptr - a pointer to a valid memory location
+//
+//   value - the value to store
+void thread_helper_store_release(volatile int *ptr, int value);
+
+// thread_helper_load_acquire_64, thread_helper_store_release_64
+//
+//   these functions read and write a 64 bit integer in memory like
+//   thread_helper_load_acquire and thread_helper_store_release, for counters
+//   that may exceed the range of an int.
+//
+// parameters:
+//
+//   ptr - a pointer to a valid memory location
+//
+//   value - the value to store
+//
+// return value:
+//
+//   thread_helper_load_acquire_64 returns the value stored at the given
+//   memory location
+unsigned long long thread_helper_load_acquire_64(volatile unsigned long long *ptr);
+void thread_helper_store_release_64(volatile unsigned long long *ptr, unsigned long long value);
+
+// thread_helper_fetch_and_add
+//
+//   this function atomically adds a value to a 64 bit integer in memory, so
+//   that concurrent additions by other threads are never lost. For a shared
+//   counter, this makes any lock unnecessary, but the cache line holding the
+//   counter still moves between the CPUs on every addition.
+//
+// parameters:
+//
+//   ptr - a pointer to a valid memory location
+//
+//   value - the value to add
+//
+// return value:
+//
+//   this function returns the value stored at the given memory location
+//   before the addition
+unsigned long long thread_helper_fetch_and_add(volatile unsigned long long *ptr, unsigned long long value);
+
+// thread_helper_cpu_relax
+//
+//   this function executes a hint to the CPU that the calling thread is busy
+//   waiting, such as the pause instruction on x86 or the yield instruction on
+//   ARM. This reduces the energy consumption of the spinning core, frees
+//   resources for a hyper-threading sibling, and avoids a costly pipeline
+//   flush when the waiting ends. It does not yield the CPU to other threads.
+void thread_helper_cpu_relax(void);
+
+// thread_helper_backoff_init
+//
+//   this function initializes the state of a bounded, randomized exponential
+//   backoff. Every thread must use its own backoff state.
+//
+// parameters:
+//
+//   backoff - a pointer to a thread_helper_backoff_t
+//
+//   min - the initial upper bound of the number of relax hints per backoff
+//
+//   max - the maximum upper bound of the number of relax hints per backoff
+//
+//   seed - the seed of the random number generator, which should differ
+//   between threads so that they do not back off in lockstep
+void thread_helper_backoff_init(thread_helper_backoff_t *backoff, unsigned long min, unsigned long max, unsigned long seed);
+
+// thread_helper_backoff
+//
+//   this function waits for a random number of relax hints, chosen below the
+//   current upper bound, and then doubles the upper bound up to its maximum.
+//   Threads that repeatedly fail to acquire a lock thereby wait exponentially
+//   longer between attempts, and the randomization spreads their attempts
+//   out, instead of having all of them retry at the same time.
+//
+// parameters:
+//
+//   backoff - a pointer to a thread_helper_backoff_t
+void thread_helper_backoff(thread_helper_backoff_t *backoff);
+
+// thread_helper_test_and_test_and_set_lock
+//
+//   this function locks a spin-lock compatible with
+//   thread_helper_test_and_set_lock, but only attempts the atomic
+//   test_and_set instruction after a plain read has seen the lock released.
+//
+//   While the lock is held, the waiting threads only read the memory location
+//   from their own caches, and generate no traffic between the CPUs. Once the
+//   lock is released, all of them would attempt test_and_set at the same time,
+//   so every failed attempt is followed by a randomized exponential backoff.
+//
+// parameters:
+//
+//   lock - a pointer to a valid memory location
+//
+//   backoff - a pointer to the thread_helper_backoff_t of the calling thread.
+//   The upper bound of the backoff is reset to its minimum on every call.
+void thread_helper_test_and_test_and_set_lock(int *lock, thread_helper_backoff_t *backoff);
+
+// thread_helper_test_and_test_and_set_timedlock
+//
+//   this function locks a spin-lock like
+//   thread_helper_test_and_test_and_set_lock, but gives up once the given
+//   deadline has passed. A single call of thread_helper_test_and_set_lock is
+//   the try-lock of this spin-lock.
+//
+// parameters:
+//
+//   lock, backoff - see thread_helper_test_and_test_and_set_lock
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_test_and_test_and_set_timedlock(int *lock, thread_helper_backoff_t *backoff, unsigned long long deadline);
+
+// thread_helper_ticket_init
+//
+//   this function initializes a ticket lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_ticket_lock_t
+void thread_helper_ticket_init(thread_helper_ticket_lock_t *lock);
+
+// thread_helper_ticket_lock
+//
+//   this function locks a ticket lock. Similar to a bakery, every thread that
+//   requests entry to the critical section draws a ticket with an atomic
+//   fetch_and_add instruction on the next counter, and then waits until the
+//   serving counter shows its number. In contrast to test_and_set, this
+//   guarantees that the threads enter the critical section in the order of
+//   their arrival, and in contrast to the Bakery Algorithm, drawing a ticket
+//   takes constant time regardless of the number of threads.
+//
+//   While waiting, the thread backs off for a time proportional to the number
+//   of threads ahead of it in the queue, to reduce the number of reads of the
+//   shared serving counter while it changes frequently.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_ticket_lock_t
+void thread_helper_ticket_lock(thread_helper_ticket_lock_t *lock);
+
+// thread_helper_ticket_unlock
+//
+//   this function unlocks a ticket lock previously locked by
+//   thread_helper_ticket_lock by advancing the serving counter, which admits
+//   the thread holding the next ticket to the critical section.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_ticket_lock_t
+void thread_helper_ticket_unlock(thread_helper_ticket_lock_t *lock);
+
+// thread_helper_ticket_trylock
+//
+//   this function locks a ticket lock only if no other thread holds it or
+//   waits for it, by drawing a ticket only if it is the one being served.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_ticket_lock_t
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_ticket_trylock(thread_helper_ticket_lock_t *lock);
+
+// thread_helper_ticket_timedlock
+//
+//   this function keeps trying to lock a ticket lock with
+//   thread_helper_ticket_trylock until it succeeds, or until the given
+//   deadline has passed. A drawn ticket cannot be given back, so the thread
+//   does not queue up, and loses the fairness of thread_helper_ticket_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_ticket_lock_t
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_ticket_timedlock(thread_helper_ticket_lock_t *lock, unsigned long long deadline);
+
+// thread_helper_mcs_init
+//
+//   this function initializes an MCS lock to the unlocked state, in which the
+//   queue of waiting threads is empty.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_mcs_lock_t
+void thread_helper_mcs_init(thread_helper_mcs_lock_t *lock);
+
+// thread_helper_mcs_lock
+//
+//   this function locks an MCS lock, named after its inventors Mellor-Crummey
+//   and Scott. The lock keeps an explicit queue of waiting threads, each
+//   represented by a node owned by the thread. A thread appends its node to
+//   the tail of the queue with an atomic exchange instruction, and then spins
+//   on the locked field of its own node until its predecessor hands the lock
+//   over to it.
+//
+//   In contrast to test_and_set and the ticket lock, every thread spins on a
+//   different cache line, so handing over the lock only invalidates the cache
+//   line of the next thread in the queue instead of those of all waiting
+//   threads.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_mcs_lock_t
+//
+//   node - a pointer to a thread_helper_mcs_node_t owned by the calling
+//   thread, that must be passed to thread_helper_mcs_unlock as well
+void thread_helper_mcs_lock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node);
+
+// thread_helper_mcs_unlock
+//
+//   this function unlocks an MCS lock previously locked by
+//   thread_helper_mcs_lock, by handing the lock over to the next thread in the
+//   queue, or by resetting the queue to empty if there is no waiting thread.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_mcs_lock_t
+//
+//   node - the pointer to the node passed to thread_helper_mcs_lock
+void thread_helper_mcs_unlock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node);
+
+// thread_helper_mcs_trylock
+//
+//   this function locks an MCS lock only if the queue of waiting threads is
+//   empty, by appending the node only to an empty queue.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_mcs_lock_t
+//
+//   node - a pointer to a thread_helper_mcs_node_t owned by the calling
+//   thread, that must be passed to thread_helper_mcs_unlock as well
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_mcs_trylock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node);
+
+// thread_helper_mcs_timedlock
+//
+//   this function keeps trying to lock an MCS lock with
+//   thread_helper_mcs_trylock until it succeeds, or until the given deadline
+//   has passed. A node cannot leave the middle of the queue, so the thread
+//   does not queue up, and spins on the tail of the queue instead of its own
+//   node.
+//
+// parameters:
+//
+//   lock, node - see thread_helper_mcs_trylock
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_mcs_timedlock(thread_helper_mcs_lock_t *lock, thread_helper_mcs_node_t *node, unsigned long long deadline);
+
+// thread_helper_clh_init
+//
+//   this function initializes a CLH lock to the unlocked state. The queue of
+//   a CLH lock is never empty, so the lock needs an initial node that is not
+//   owned by any thread.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_clh_lock_t
+//
+//   node - a pointer to the initial thread_helper_clh_node_t
+void thread_helper_clh_init(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t *node);
+
+// thread_helper_clh_lock
+//
+//   this function locks a CLH lock, named after its inventors Craig, Landin
+//   and Hagersten. Like the MCS lock, the CLH lock keeps a queue of nodes, but
+//   the queue is linked implicitly: a thread appends its node with an atomic
+//   exchange instruction, which returns the node of its predecessor, and then
+//   spins on the locked field of the predecessor's node.
+//
+//   When the lock is released, the releasing thread takes over the node of
+//   its predecessor for its next acquisition, because its own node may still
+//   be observed by its successor. This is why the node is passed by reference.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_clh_lock_t
+//
+//   node - a pointer to a pointer to a thread_helper_clh_node_t owned by the
+//   calling thread, that must be passed to thread_helper_clh_unlock as well
+void thread_helper_clh_lock(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t **node);
+
+// thread_helper_clh_unlock
+//
+//   this function unlocks a CLH lock previously locked by
+//   thread_helper_clh_lock, by clearing the locked field of the node of the
+//   calling thread, which releases its successor. Afterwards, the node of the
+//   calling thread is replaced by the node of its predecessor.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_clh_lock_t
+//
+//   node - the pointer to the node pointer passed to thread_helper_clh_lock
+void thread_helper_clh_unlock(thread_helper_clh_lock_t *lock, thread_helper_clh_node_t **node);
+
+// thread_helper_adaptive_init
+//
+//   this function initializes an adaptive lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_adaptive_lock_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_adaptive_init(thread_helper_adaptive_lock_t *lock);
+
+// thread_helper_adaptive_lock
+//
+//   this function locks an adaptive lock. Spin-locks waste the CPU while the
+//   lock holder is not running, for example when there are more threads than
+//   CPUs, while mutexes pay for system calls and context switches even if the
+//   lock is only held for a few instructions. The adaptive lock combines both:
+//   a waiting thread first spins for a bounded number of iterations, and then
+//   parks itself, like the futex mutex, until the lock is released.
+//
+//   The number of iterations tunes itself: the lock keeps a moving average of
+//   the number of iterations that successful spinning took, which reflects the
+//   recent hold times of the lock, and spins up to twice this average. Failed
+//   spinning lowers the average, so that threads quickly stop spinning when
+//   the lock holder is not running at the same time.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_adaptive_lock_t
+void thread_helper_adaptive_lock(thread_helper_adaptive_lock_t *lock);
+
+// thread_helper_adaptive_unlock
+//
+//   this function unlocks an adaptive lock previously locked by
+//   thread_helper_adaptive_lock, and wakes up one parked thread, if any.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_adaptive_lock_t
+void thread_helper_adaptive_unlock(thread_helper_adaptive_lock_t *lock);
+
+// thread_helper_adaptive_trylock
+//
+//   this function locks an adaptive lock only if it is not held, without
+//   spinning or parking.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_adaptive_lock_t
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_adaptive_trylock(thread_helper_adaptive_lock_t *lock);
+
+// thread_helper_adaptive_timedlock
+//
+//   this function keeps trying to lock an adaptive lock with
+//   thread_helper_adaptive_trylock until it succeeds, or until the given
+//   deadline has passed. Parking has no timeout on every system, so the thread
+//   only spins, and never parks.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_adaptive_lock_t
+//
+//   deadline - the time to give up, as returned by thread_helper_time_ns
+//
+// return value:
+//
+//   the function returns 0 if the lock was acquired, and 1 otherwise.
+int thread_helper_adaptive_timedlock(thread_helper_adaptive_lock_t *lock, unsigned long long deadline);
+
+// thread_helper_cohort_init
+//
+//   this function initializes a cohort lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_cohort_lock_t
+//
+//   bound - the maximum number of times in a row the lock is passed to a
+//   waiting thread on the same node, before it is handed to another node
+void thread_helper_cohort_init(thread_helper_cohort_lock_t *lock, unsigned long bound);
+
+// thread_helper_cohort_lock
+//
+//   this function locks a cohort lock. On machines with multiple NUMA nodes,
+//   every handoff of a global lock between threads on different nodes moves
+//   the cache lines of the lock, and of the data it protects, across the
+//   interconnect. The cohort lock reduces these handoffs: a thread first
+//   acquires the local lock of its node, and then the global lock, unless a
+//   thread of the same node passed the global lock on to it with the local
+//   lock. The threads of a node thereby form a cohort, that keeps the global
+//   lock until no thread of the node is waiting anymore, or the lock has been
+//   passed on within the node bound times in a row, which keeps the threads
+//   of the other nodes from starving.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_cohort_lock_t
+//
+//   node - the NUMA node of the calling thread, as reported by
+//   thread_helper_topology, modulo THREAD_HELPER_COHORT_NODES
+void thread_helper_cohort_lock(thread_helper_cohort_lock_t *lock, int node);
+
+// thread_helper_cohort_unlock
+//
+//   this function unlocks a cohort lock previously locked by
+//   thread_helper_cohort_lock, passing the global lock on to the next thread
+//   of the same node, if there is one and the bound is not reached yet.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_cohort_lock_t
+//
+//   node - the node passed to thread_helper_cohort_lock
+void thread_helper_cohort_unlock(thread_helper_cohort_lock_t *lock, int node);
+
+// thread_helper_spin_rwlock_init
+//
+//   this function initializes a reader-writer spin-lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_spin_rwlock_t
+void thread_helper_spin_rwlock_init(thread_helper_spin_rwlock_t *lock);
+
+// thread_helper_spin_rwlock_read_lock
+//
+//   this function locks a reader-writer spin-lock for reading. A reader
+//   increments the number of readers, unless a writer holds or waits for the
+//   lock, in which case it spins until the writer is done. Waiting writers
+//   therefore take precedence over arriving readers, so that a steady stream
+//   of readers cannot starve the writers.
+//
+//   All readers modify the same counter, so its cache line moves between the
+//   CPUs of the readers, even though they do not exclude each other.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_spin_rwlock_t
+void thread_helper_spin_rwlock_read_lock(thread_helper_spin_rwlock_t *lock);
+
+// thread_helper_spin_rwlock_read_unlock
+//
+//   this function unlocks a reader-writer spin-lock previously locked by
+//   thread_helper_spin_rwlock_read_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_spin_rwlock_t
+void thread_helper_spin_rwlock_read_unlock(thread_helper_spin_rwlock_t *lock);
+
+// thread_helper_spin_rwlock_write_lock
+//
+//   this function locks a reader-writer spin-lock for writing. A writer first
+//   raises the writer flag, which keeps new readers out, and then spins until
+//   the readers holding the lock have left.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_spin_rwlock_t
+void thread_helper_spin_rwlock_write_lock(thread_helper_spin_rwlock_t *lock);
+
+// thread_helper_spin_rwlock_write_unlock
+//
+//   this function unlocks a reader-writer spin-lock previously locked by
+//   thread_helper_spin_rwlock_write_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_spin_rwlock_t
+void thread_helper_spin_rwlock_write_unlock(thread_helper_spin_rwlock_t *lock);
+
+// thread_helper_brlock_init
+//
+//   this function initializes a big reader lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_brlock_t
+//
+//   slots - an array of slots, one for every reader
+//
+//   nslots - the number of slots in the array
+void thread_helper_brlock_init(thread_helper_brlock_t *lock, thread_helper_brlock_slot_t *slots, size_t nslots);
+
+// thread_helper_brlock_read_lock
+//
+//   this function locks a big reader lock for reading. Instead of a shared
+//   counter, every reader marks its own slot as active, so that readers never
+//   write to the same cache line, and reading scales with the number of CPUs.
+//   The price is paid by the writers, which have to check the slots of all
+//   readers.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_brlock_t
+//
+//   slot - the index of the slot of the calling thread
+void thread_helper_brlock_read_lock(thread_helper_brlock_t *lock, size_t slot);
+
+// thread_helper_brlock_read_unlock
+//
+//   this function unlocks a big reader lock previously locked by
+//   thread_helper_brlock_read_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_brlock_t
+//
+//   slot - the index passed to thread_helper_brlock_read_lock
+void thread_helper_brlock_read_unlock(thread_helper_brlock_t *lock, size_t slot);
+
+// thread_helper_brlock_write_lock
+//
+//   this function locks a big reader lock for writing. A writer raises the
+//   writer flag, which keeps new readers out, and then waits until the slots
+//   of all readers are inactive.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_brlock_t
+void thread_helper_brlock_write_lock(thread_helper_brlock_t *lock);
+
+// thread_helper_brlock_write_unlock
+//
+//   this function unlocks a big reader lock previously locked by
+//   thread_helper_brlock_write_lock.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_brlock_t
+void thread_helper_brlock_write_unlock(thread_helper_brlock_t *lock);
+
+// thread_helper_seqlock_init
+//
+//   this function initializes a sequence lock to the unlocked state.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_seqlock_t
+void thread_helper_seqlock_init(thread_helper_seqlock_t *lock);
+
+// thread_helper_seqlock_read_begin
+//
+//   this function begins an optimistic read of the data protected by a
+//   sequence lock. Readers of a sequence lock do not write to memory at all:
+//   a reader remembers the sequence counter, reads the data, and then checks
+//   with thread_helper_seqlock_read_retry whether a writer modified the data
+//   in the meantime, in which case the data read may be inconsistent and the
+//   reader has to start over. The data must therefore only be read, never
+//   acted upon, before the check succeeded.
+//
+//   If a writer currently modifies the data, the function spins until it is
+//   done.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_seqlock_t
+//
+// return value:
+//
+//   the function returns the sequence counter, to be passed to
+//   thread_helper_seqlock_read_retry. The counter is unsigned, so that it
+//   wraps around instead of overflowing in long runs.
+unsigned thread_helper_seqlock_read_begin(thread_helper_seqlock_t *lock);
+
+// thread_helper_seqlock_read_retry
+//
+//   this function ends an optimistic read begun by
+//   thread_helper_seqlock_read_begin.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_seqlock_t
+//
+//   sequence - the sequence counter returned by
+//   thread_helper_seqlock_read_begin
+//
+// return value:
+//
+//   the function returns 0 if the data read is consistent, and 1 if a writer
+//   modified it in the meantime, and the read has to be retried.
+int thread_helper_seqlock_read_retry(thread_helper_seqlock_t *lock, unsigned sequence);
+
+// thread_helper_seqlock_write_lock
+//
+//   this function locks a sequence lock for writing, excluding other writers,
+//   and makes the sequence counter odd, so that concurrent readers retry.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_seqlock_t
+void thread_helper_seqlock_write_lock(thread_helper_seqlock_t *lock);
+
+// thread_helper_seqlock_write_unlock
+//
+//   this function unlocks a sequence lock previously locked by
+//   thread_helper_seqlock_write_lock, and makes the sequence counter even
+//   again.
+//
+// parameters:
+//
+//   lock - a pointer to a thread_helper_seqlock_t
+void thread_helper_seqlock_write_unlock(thread_helper_seqlock_t *lock);
+
+// thread_helper_barrier_init
+//
+//   this function initializes a barrier, an object used to make a number of
+//   threads wait for each other. Threads that arrive at the barrier by calling
+//   thread_helper_barrier_wait are blocked until the given number of threads
+//   have arrived, and are then released all at the same time.
+//
+// parameters:
+//
+//   barrier - a pointer to a thread_helper_barrier_t that holds the reference
+//   to the barrier object in the used implementation
+//
+//   count - the number of threads that must arrive at the barrier before any
+//   of them is released
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_barrier_init(thread_helper_barrier_t *barrier, unsigned count);
+
+// thread_helper_barrier_wait
+//
+//   this function blocks the calling thread at the barrier, until the number
+//   of threads given to thread_helper_barrier_init have arrived. The barrier
+//   can be reused after all threads have been released.
+//
+//   On systems without native barriers, the waiting is implemented through
+//   busy waiting, yielding the CPU to other threads in every iteration.
+//
+// parameters:
+//
+//   barrier - a pointer to a thread_helper_barrier_t that holds the reference
+//   to the barrier object in the used implementation
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_barrier_wait(thread_helper_barrier_t *barrier);
+
+// thread_helper_barrier_destroy
+//
+//   this function frees the resources of a barrier that was initialized with
+//   thread_helper_barrier_init. No thread may be waiting at the barrier.
+//
+// parameters:
+//
+//   barrier - a pointer to a thread_helper_barrier_t that holds the reference
+//   to the barrier object in the used implementation
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_barrier_destroy(thread_helper_barrier_t *barrier);
+
+// thread_helper_pool_init
+//
+//   this function creates a pool of worker threads, which wait at a barrier
+//   until a job is dispatched to them with thread_helper_pool_run. Creating and
+//   joining threads takes much longer than a short experiment, so running many
+//   short experiments on the same workers measures the experiments instead of
+//   the operating system.
+//
+//   If a worker cannot be created, the workers created before it are
+//   terminated and joined again, and the pool is left uninitialized.
+//
+// parameters:
+//
+//   pool - a pointer to a thread_helper_pool_t
+//
+//   workers - a pointer to an array of count thread_helper_pool_worker_t, that
+//   must remain valid until thread_helper_pool_destroy
+//
+//   count - the number of worker threads
+//
+//   cpus - a pointer to an array of count CPU numbers to pin the workers to,
+//   see thread_helper_create_on_cpu, or NULL to create them without pinning
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_pool_init(thread_helper_pool_t *pool, thread_helper_pool_worker_t *workers, size_t count, const int *cpus);
+
+// thread_helper_pool_run
+//
+//   this function runs a job on all workers of a pool, and blocks until all of
+//   them have finished it. Each worker calls the given function with its own
+//   argument, taken from an array of elements of the given size, in the order
+//   of the workers.
+//
+// parameters:
+//
+//   pool - a pointer to a thread_helper_pool_t
+//
+//   func - the function to run on every worker
+//
+//   args - a pointer to an array of one argument per worker
+//
+//   size - the size of each argument in bytes
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_pool_run(thread_helper_pool_t *pool, thread_func_t func, void *args, size_t size);
+
+// thread_helper_pool_destroy
+//
+//   this function terminates and joins all workers of a pool, and frees its
+//   resources.
+//
+// parameters:
+//
+//   pool - a pointer to a thread_helper_pool_t
+//
+// return value:
+//
+//   the function returns 0 on success, and 1 otherwise.
+int thread_helper_pool_destroy(thread_helper_pool_t *pool);
+
+// thread_helper_time_ns
+//
+//   this function reads a monotonic clock with high resolution. The absolute
+//   value of the clock is meaningless, but the difference between two calls
+//   gives the wall-clock time that has passed between them, unaffected by
+//   changes to the system time.
+//
+// return value:
+//
+//   the function returns the current value of the monotonic clock in
+//   nanoseconds.
+unsigned long long thread_helper_time_ns(void);
+
+// thread_helper_thread_cpu_time_ns
+//
+//   this function reads the CPU time consumed by the calling thread so far,
+//   both in user mode and in kernel mode. In contrast to the wall-clock time,
+//   the CPU time does not advance while the thread is blocked or waiting to be
+//   scheduled, but it does advance while the thread is busy waiting.
+//
+// return value:
+//
+//   the function returns the CPU time of the calling thread in nanoseconds.
+unsigned long long thread_helper_thread_cpu_time_ns(void);
+
+// thread_helper_counters_open
+//
+//   this function prepares the performance counters of the calling thread,
+//   without starting them yet, so that the system calls needed to set them up
+//   are not counted. It tries to open a group of hardware counters for the
+//   cycles, the instructions and the last level cache misses, together with a
+//   software counter for the migrations between CPUs, and falls back to the
+//   software counter alone if hardware counters are not available or not
+//   permitted.
+//
+// parameters:
+//
+//   counters - a pointer to a thread_helper_counters_t
+//
+// return value:
+//
+//   the function returns 0 if at least the context switches can be counted,
+//   and 1 otherwise.
+int thread_helper_counters_open(thread_helper_counters_t *counters);
+
+// thread_helper_counters_start
+//
+//   this function starts the performance counters of the calling thread
+//   prepared by thread_helper_counters_open.
+//
+// parameters:
+//
+//   counters - a pointer to a thread_helper_counters_t
+void thread_helper_counters_start(thread_helper_counters_t *counters);
+
+// thread_helper_counters_stop
+//
+//   this function stops the performance counters of the calling thread, stores
+//   the counted events in the given thread_helper_counters_t, and releases the
+//   counters. Events that could not be counted are left at 0; the hardware
+//   field tells whether the hardware counters were available.
+//
+// parameters:
+//
+//   counters - a pointer to a thread_helper_counters_t
+void thread_helper_counters_stop(thread_helper_counters_t *counters);
+
 #endif